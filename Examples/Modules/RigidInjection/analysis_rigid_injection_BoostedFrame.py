@@ -20,17 +20,17 @@ The simulation runs in a boosted frame, and the analysis is done in the lab
 frame, i.e., on the back-transformed diagnostics.
 '''
 
-import yt
 import numpy as np
-import read_raw_data
-yt.funcs.mylog.setLevel(0)
+import openpmd_api as io
 
 # Read data from back-transformed diagnostics
-snapshot = './lab_frame_data/snapshots/snapshot00001'
-header   = './lab_frame_data/snapshots/Header'
-allrd, info = read_raw_data.read_lab_snapshot(snapshot, header)
-z = np.mean( read_raw_data.get_particle_field(snapshot, 'beam', 'z') )
-w = np.std ( read_raw_data.get_particle_field(snapshot, 'beam', 'x') )
+series = io.Series('./diags/btd_openpmd/openpmd_%T.h5', io.Access.read_only)
+beam = series.iterations[1].particles['beam']
+z = beam['position']['z'][:]
+x = beam['position']['x'][:]
+series.flush()
+z = np.mean( z )
+w = np.std ( x )
 
 # initial parameters
 z0 = 20.e-6
@@ -17,24 +17,24 @@ between the full back-transformed diagnostic and the reduced diagnostic (i.e., x
 '''
 
 import numpy as np
-import read_raw_data
+import yt
+yt.funcs.mylog.setLevel(0)
 
 # Read data from back-transformed diagnostics of entire domain
-snapshot = './lab_frame_data/snapshots/snapshot00002'
-header   = './lab_frame_data/snapshots/Header'
-allrd, info = read_raw_data.read_lab_snapshot(snapshot, header)
-F = allrd['Ez']
+ds = yt.load('./diags/btd_pltfile00002')
+ad = ds.covering_grid(level=0, left_edge=ds.domain_left_edge, dims=ds.domain_dimensions)
+F = ad['Ez'].v
 print("F.shape ", F.shape)
 F_1D = np.squeeze(F[F.shape[0]//2,F.shape[1]//2,:])
 
 
 # Read data from reduced back-transformed diagnostics (i.e. slice)
-snapshot_slice = './lab_frame_data/slices/slice00002'
-header_slice   = './lab_frame_data/slices/Header'
-allrd, info = read_raw_data.read_lab_snapshot(snapshot_slice, header_slice)
-Fs = allrd['Ez']
+ds_slice = yt.load('./diags/btd_pltfile_slice00002')
+ad_slice = ds_slice.covering_grid(level=0, left_edge=ds_slice.domain_left_edge,
+                                  dims=ds_slice.domain_dimensions)
+Fs = ad_slice['Ez'].v
 print("Fs.shape", Fs.shape)
-Fs_1D = np.squeeze(Fs[Fs.shape[0]//2,1,:])
+Fs_1D = np.squeeze(Fs[Fs.shape[0]//2,0,:])
 
 error_rel = np.max(np.abs(Fs_1D - F_1D)) / np.max(np.abs(F_1D))
 tolerance_rel = 1E-15
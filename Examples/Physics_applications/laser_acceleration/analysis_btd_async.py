@@ -0,0 +1,52 @@
+#! /usr/bin/env python
+
+# Copyright 2026 The WarpX Community
+#
+# This file is part of WarpX.
+#
+# License: BSD-3-Clause-LBNL
+
+'''
+Analysis script of the back-transformed diagnostics with asynchronous output.
+
+The simulation runs with amrex.async_out = 1 and two identical back-transformed
+diagnostics: btd, with the synchronous flush, and btd_async, with
+btd_async.async_flush = 1, whose buffers are appended to the lab-frame snapshots
+by the AMReX I/O thread. Each snapshot of btd_async must be the same as the
+snapshot of btd, and the full diagnostics must match the benchmark of the
+synchronous LaserAccelerationBoost test.
+'''
+
+import glob
+import sys
+
+import numpy as np
+import yt
+yt.funcs.mylog.setLevel(0)
+sys.path.insert(1, '../../../../warpx/Regression/Checksum/')
+import checksumAPI
+
+fields = ['Ex', 'Ey', 'Ez', 'Bx', 'By', 'Bz', 'jx', 'jy', 'jz', 'rho']
+
+snapshots = sorted(glob.glob('./diags/btd[0-9]*'))
+print('snapshots: ', snapshots)
+assert( len(snapshots) > 0 )
+
+for snapshot in snapshots:
+    snapshot_async = snapshot.replace('btd', 'btd_async')
+    ds = yt.load( snapshot )
+    ds_async = yt.load( snapshot_async )
+    assert( np.all(ds.domain_dimensions == ds_async.domain_dimensions) )
+    data = ds.covering_grid(level=0, left_edge=ds.domain_left_edge,
+                            dims=ds.domain_dimensions)
+    data_async = ds_async.covering_grid(level=0, left_edge=ds_async.domain_left_edge,
+                                        dims=ds_async.domain_dimensions)
+    for field in fields:
+        F = data[('boxlib', field)].to_ndarray()
+        F_async = data_async[('boxlib', field)].to_ndarray()
+        print('%s, %s: max difference = %.3e' %(snapshot_async, field, np.amax(np.abs(F_async - F))))
+        assert( np.array_equal(F, F_async) )
+
+# The asynchronous output does not change the full diagnostics
+fn = sys.argv[1]
+checksumAPI.evaluate_checksum('LaserAccelerationBoost', fn)
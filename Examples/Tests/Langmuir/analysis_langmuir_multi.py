@@ -35,6 +35,23 @@ current_correction = True if re.search( 'current_correction', fn ) else False
 # Parse test name and check if Vay current deposition (algo.current_deposition=vay) is used
 vay_deposition = True if re.search( 'Vay_deposition', fn ) else False
 
+# Parse test name and check if the Esirkepov deposition is used with a
+# high-order particle shape (algo.particle_shape=4 or 5)
+esirkepov_high_order = True if re.search( 'Esirkepov_shape', fn ) else False
+
+# Parse test name and check if the particles are stored in single precision
+# while the fields are in double precision (USE_SINGLE_PRECISION_PARTICLES=TRUE)
+mixed_precision = True if re.search( 'mixed_precision', fn ) else False
+
+# Parse test name and check if the current is deposited by blocks of cells
+# (warpx.do_blocked_current_deposition=1) or in the same loop as the push
+# (warpx.do_fused_push_and_deposition=1), or if the particles are pushed by batches
+# with the SIMD kernels (warpx.do_simd_particle_push=1): the result must be the same as
+# with the standard algorithms, up to the order of the floating-point operations.
+# Same for the fields written with aggregated I/O (diag1.aggregate_io=1), which
+# must be read back as the standard plotfile.
+same_as_standard = True if re.search( 'blocked_deposition|fused_push|simd_push|aggregate_io', fn ) else False
+
 # Parameters (these parameters must match the parameters in `inputs.multi.rt`)
 epsilon = 0.01
 n = 4.e24
@@ -130,9 +147,10 @@ print("tolerance_rel: " + str(tolerance_rel))
 assert( error_rel < tolerance_rel )
 
 # Check relative L-infinity spatial norm of rho/epsilon_0 - div(E) when
-# current correction (psatd.do_current_correction=1) is applied or when
-# Vay current deposition (algo.current_deposition=vay) is used
-if current_correction or vay_deposition:
+# current correction (psatd.do_current_correction=1) is applied, when
+# Vay current deposition (algo.current_deposition=vay) is used, or when
+# Esirkepov current deposition is used with a high-order particle shape
+if current_correction or vay_deposition or esirkepov_high_order:
     rho  = data['rho' ].to_ndarray()
     divE = data['divE'].to_ndarray()
     error_rel = np.amax( np.abs( divE - rho/epsilon_0 ) ) / np.amax( np.abs( rho/epsilon_0 ) )
@@ -142,9 +160,39 @@ if current_correction or vay_deposition:
     print("tolerance = {}".format(tolerance))
     assert( error_rel < tolerance )
 
+# Check charge conservation when the Esirkepov deposition accumulates the current
+# of single-precision particles into double-precision fields. rho and divE are written
+# by a second diagnostic (diag_divE), so that diag1 has the same fields as Langmuir_multi.
+# The particle positions are stored as absolute coordinates in single precision: the
+# old position recomputed by the deposition differs from the stored one by the rounding
+# of the position (about 1e-6 cell here), which accumulates in divE - rho/epsilon_0.
+if mixed_precision:
+    ds_divE = yt.load( 'diags/divE' + fn[-5:] )
+    data_divE = ds_divE.covering_grid(level=0, left_edge=ds_divE.domain_left_edge,
+                                      dims=ds_divE.domain_dimensions)
+    rho  = data_divE['rho' ].to_ndarray()
+    divE = data_divE['divE'].to_ndarray()
+    error_rel = np.amax( np.abs( divE - rho/epsilon_0 ) ) / np.amax( np.abs( rho/epsilon_0 ) )
+    tolerance = 1.e-3
+    print("Check charge conservation:")
+    print("error_rel = {}".format(error_rel))
+    print("tolerance = {}".format(tolerance))
+    assert( error_rel < tolerance )
+
 test_name = fn[:-9] # Could also be os.path.split(os.getcwd())[1]
 
-if re.search( 'single_precision', fn ):
+if same_as_standard:
+    # Compare with the benchmark of the test that uses the standard algorithms
+    checksumAPI.evaluate_checksum('Langmuir_multi', fn)
+elif esirkepov_high_order:
+    # The physical checks above (field amplitude and charge conservation) are the
+    # reference for the high-order shapes, which have no checksum benchmark
+    pass
+elif mixed_precision:
+    # Compare with the benchmark of the test with double-precision particles, up to
+    # the rounding of the particle data to single precision
+    checksumAPI.evaluate_checksum('Langmuir_multi', fn, rtol=1.e-3)
+elif re.search( 'single_precision', fn ):
     checksumAPI.evaluate_checksum(test_name, fn, rtol=1.e-3)
 else:
     checksumAPI.evaluate_checksum(test_name, fn)
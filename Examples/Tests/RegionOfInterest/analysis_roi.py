@@ -0,0 +1,48 @@
+#! /usr/bin/env python
+
+# Copyright 2026 The WarpX Community
+#
+# This file is part of WarpX.
+#
+# License: BSD-3-Clause-LBNL
+
+# This script checks the region-of-interest field output (<diag_name>.roi_names).
+# The simulation writes, at the same iteration, a plotfile with the raw fields
+# (diag1.plot_raw_fields = 1) and the fields in regions of interest (diagnostics roi).
+# The fields read back in each region must be identical to the raw fields
+# at the same indices, and each region must cover its physical bounds.
+
+import sys
+from glob import glob
+
+import numpy as np
+from read_raw_data import read_data, read_roi_data
+
+# this will be the name of the plot file
+fn = sys.argv[1]
+
+raw_data = read_data(fn)[0]
+roi_dirs = sorted(glob('diags/roi*'))
+assert len(roi_dirs) > 0, 'No region-of-interest output found'
+info, roi_data = read_roi_data(roi_dirs[-1])
+
+# Names of the raw fields of the plotfile for the fields of the regions
+raw_names = {'Ex': 'Ex_aux', 'Ey': 'Ey_aux', 'Ez': 'Ez_aux',
+             'Bx': 'Bx_aux', 'By': 'By_aux', 'Bz': 'Bz_aux',
+             'jx': 'jx_fp', 'jy': 'jy_fp', 'jz': 'jz_fp'}
+
+prob_lo = info['prob_lo'][0]
+dx = info['dx'][0]
+for roi, fields in roi_data[0].items():
+    roi_lo, roi_hi = info['roi'][roi]
+    assert len(fields) > 0, 'No data in region ' + roi
+    for field, (lo, arr) in fields.items():
+        raw = raw_data[raw_names[field]]
+        hi = lo + np.array(arr.shape) - 1
+        # The region covers its physical bounds
+        assert np.all(prob_lo + lo*dx <= roi_lo + 1.e-6*dx)
+        assert np.all(prob_lo + (hi+1)*dx >= roi_hi - 1.e-6*dx)
+        # The data is identical to the raw field data
+        ref = raw[tuple(slice(l, h+1) for l, h in zip(lo, hi))]
+        print('%s, %s: indices %s to %s, max abs: %.3e' % (roi, field, lo, hi, np.abs(ref).max()))
+        assert np.array_equal(arr, ref), field + ' differs from the raw data in region ' + roi
@@ -0,0 +1,92 @@
+#! /usr/bin/env python
+
+# Copyright 2026 The WarpX Community
+#
+# This file is part of WarpX.
+#
+# License: BSD-3-Clause-LBNL
+
+# This file is part of the WarpX automated test suite. It is used to test the
+# in_transit output format, with the reader of Tools/PostProcessing/read_in_transit.py
+# as the consumer:
+#
+# - Run the WarpX simulation in the background
+# - Read the messages of diag1 from the shared-memory buffer while the simulation runs
+# - Compare the fields and the number of particles of each message with the
+#   plotfiles written by diag2 at the same iterations
+
+import glob
+import subprocess
+import sys
+import time
+
+import numpy as np
+import yt ; yt.funcs.mylog.setLevel(50)
+
+from read_in_transit import InTransitReader
+
+# The data is copied from the MultiFab to the buffer: it must be identical
+tolerance = 1.e-14
+
+def consume(process, path):
+    '''Read all the messages published in the buffer while the simulation runs.'''
+    reader = InTransitReader(path)
+    messages = {}
+    last = 0
+    while True:
+        running = process.poll() is None
+        head = reader.num_messages()
+        while last < head:
+            msg = reader.read(last)
+            if msg is None:
+                # The message is still being written
+                break
+            messages[msg['iteration']] = msg
+            last += 1
+        if not running and last == head:
+            break
+        time.sleep(0.01)
+    reader.close()
+    return messages
+
+def check_message(msg, fn):
+    print('Iteration %d: %s' %(msg['iteration'], fn))
+    ds = yt.load( fn )
+    data = ds.covering_grid(level=0, left_edge=ds.domain_left_edge,
+                            dims=ds.domain_dimensions)
+    domain_lo = msg['levels'][0]['domain_lo']
+    for n, field in enumerate(msg['fields']):
+        F = data[('boxlib', field)].to_ndarray()[:,:,0]
+        F_transit = np.zeros_like(F)
+        for lev, lo, hi, arr in msg['fabs']:
+            F_transit[lo[0]-domain_lo[0]:hi[0]-domain_lo[0]+1,
+                      lo[1]-domain_lo[1]:hi[1]-domain_lo[1]+1] = arr[:,:,n]
+        scale = np.amax(np.abs(F))
+        error = np.amax(np.abs(F_transit - F))
+        error_rel = error/scale if scale > 0. else error
+        print('    %s: max error = %.3e' %(field, error_rel))
+        assert( error_rel < tolerance )
+
+    ad = ds.all_data()
+    w = ad['electrons', 'particle_weight'].to_ndarray()
+    w_transit = msg['species']['electrons']['weight']
+    print('    electrons: %d particles' %w_transit.size)
+    assert( w_transit.size == w.size )
+    assert( np.isclose(np.sum(w_transit), np.sum(w), rtol=tolerance, atol=0.) )
+
+def main():
+    executables = glob.glob("main2d*")
+    assert( len(executables) == 1 )
+    process = subprocess.Popen(["./" + executables[0], "inputs_2d"])
+    messages = consume(process, "./warpx_diag1_0")
+    assert( process.returncode == 0 )
+
+    iterations = sorted(messages.keys())
+    print('Iterations read in transit: ', iterations)
+    assert( len(iterations) >= 4 )
+    for iteration in iterations:
+        check_message(messages[iteration], 'diags/plt%05d' %iteration)
+    print('Passed')
+
+if __name__ == "__main__":
+    main()
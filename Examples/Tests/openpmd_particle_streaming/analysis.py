@@ -0,0 +1,54 @@
+#! /usr/bin/env python
+
+# Copyright 2026 The WarpX Community
+#
+# This file is part of WarpX.
+#
+# License: BSD-3-Clause-LBNL
+
+# This script checks that the particles streamed to openPMD files by chunks
+# (<diag_name>.openpmd_particle_chunk_size > 0) are the same as the particles
+# written by the default path, with and without particle filters.
+# The particles are sorted by id, since the order in which the tiles are
+# written is not the same for both paths.
+
+import sys
+import numpy as np
+import openpmd_api as io
+
+iteration = 20
+
+def read_species(prefix, species):
+    series = io.Series(prefix+"/openpmd_%T.h5", io.Access.read_only)
+    ps = series.iterations[iteration].particles[species]
+    SCALAR = io.Mesh_Record_Component.SCALAR
+    records = {
+        'id': ps["id"][SCALAR],
+        'w': ps["weighting"][SCALAR],
+        'x': ps["position"]["x"],
+        'z': ps["position"]["z"],
+        'ux': ps["momentum"]["x"],
+        'uy': ps["momentum"]["y"],
+        'uz': ps["momentum"]["z"]
+    }
+    data = {name: record[:] for name, record in records.items()}
+    series.flush()
+    order = np.argsort(data['id'])
+    return {name: values[order] for name, values in data.items()}
+
+def compare(prefix, prefix_chunks, species):
+    data = read_species(prefix, species)
+    data_chunks = read_species(prefix_chunks, species)
+    print('%s, %s: %d particles' %(prefix_chunks, species, data['id'].size))
+    assert( data['id'].size > 0 )
+    for name in data.keys():
+        assert( np.array_equal(data[name], data_chunks[name]) )
+    return data['id'].size
+
+# diag1 is the default path, its prefix is given by the regression suite
+prefix = sys.argv[1]
+
+for species in ['electrons', 'positrons']:
+    n_total = compare(prefix, 'diags/diag_chunks', species)
+    n_filtered = compare('diags/diag_filter', 'diags/diag_filter_chunks', species)
+    assert( n_filtered < n_total )
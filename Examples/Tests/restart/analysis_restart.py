@@ -1,5 +1,7 @@
 #! /usr/bin/env python
 
+import os
+import re
 import sys
 import yt
 import numpy as np
@@ -9,7 +11,20 @@ import checksumAPI
 tolerance = sys.float_info.epsilon
 print('tolerance = ', tolerance)
 
-filename = 'restart_plt00010'
+filename = sys.argv[1]
+test_name = filename[:-9] # Could also be os.path.split(os.getcwd())[1]
+
+# With chk.local_dir, the checkpoints are written to a node-local directory and copied
+# to chk.file_prefix: check that the restart used the copy. The node-local copy of the
+# checkpoint used for restart was removed once the next checkpoint was copied,
+# while the last checkpoint is kept in the node-local directory.
+local_dir = True if re.search( 'local_dir', filename ) else False
+if local_dir:
+    local_chk_dir = test_name + '_node_local'
+    assert( os.path.isdir(test_name + '_chk00005') )
+    assert( not os.path.exists(os.path.join(local_chk_dir, test_name + '_chk00005')) )
+    assert( os.path.isdir(os.path.join(local_chk_dir, test_name + '_chk00010')) )
+
 ds  = yt.load( filename )
 ad  = ds.all_data()
 xb  = ad['beam',     'particle_position_x'].to_ndarray()
@@ -17,8 +32,7 @@ xe  = ad['plasma_e', 'particle_position_x'].to_ndarray()
 zb  = ad['beam',     'particle_position_z'].to_ndarray()
 ze  = ad['plasma_e', 'particle_position_z'].to_ndarray()
 
-filename = 'orig_restart_plt00010'
-ds  = yt.load( filename )
+ds  = yt.load( 'orig_' + filename )
 ad  = ds.all_data()
 xb0 = ad['beam',     'particle_position_x'].to_ndarray()
 xe0 = ad['plasma_e', 'particle_position_x'].to_ndarray()
@@ -41,6 +55,8 @@ ze.sort()
 ze0.sort()
 assert(np.max(abs(ze-ze0))<tolerance)
 
-filename = sys.argv[1]
-test_name = filename[:-9] # Could also be os.path.split(os.getcwd())[1]
-checksumAPI.evaluate_checksum(test_name, filename)
+if local_dir:
+    # Same simulation as the test without node-local directory
+    checksumAPI.evaluate_checksum('restart', filename)
+else:
+    checksumAPI.evaluate_checksum(test_name, filename)
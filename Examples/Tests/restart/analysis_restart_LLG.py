@@ -0,0 +1,46 @@
+#! /usr/bin/env python
+
+# Copyright 2026 The WarpX Community
+#
+# This file is part of WarpX.
+#
+# License: BSD-3-Clause-LBNL
+
+# This script checks that a simulation of the coupled LLG and Maxwell equations
+# that is restarted from a checkpoint, on different grids (amr.restart_regrid = 1),
+# gives the same fields (E, H, B and M) as the uninterrupted simulation.
+# The regression suite stores the output of the uninterrupted simulation with
+# the prefix "orig_".
+
+import sys
+import yt
+import numpy as np
+yt.funcs.mylog.setLevel(0)
+
+# Relative tolerance: the regridding does not change the arithmetic of the update
+tolerance = 1.e-12
+print('tolerance = ', tolerance)
+
+fn = sys.argv[1]
+fn_orig = 'orig_' + fn
+
+ds = yt.load( fn )
+ds_orig = yt.load( fn_orig )
+data = ds.covering_grid(level=0, left_edge=ds.domain_left_edge,
+                        dims=ds.domain_dimensions)
+data_orig = ds_orig.covering_grid(level=0, left_edge=ds_orig.domain_left_edge,
+                                  dims=ds_orig.domain_dimensions)
+
+fields = ['Ex', 'Ey', 'Ez', 'Hx', 'Hy', 'Hz', 'Bx', 'By', 'Bz',
+          'Mx_xface', 'My_xface', 'Mz_xface',
+          'Mx_yface', 'My_yface', 'Mz_yface',
+          'Mx_zface', 'My_zface', 'Mz_zface']
+
+for field in fields:
+    F = data[('boxlib', field)].to_ndarray()
+    F_orig = data_orig[('boxlib', field)].to_ndarray()
+    scale = np.amax(np.abs(F_orig))
+    error = np.amax(np.abs(F - F_orig))
+    error_rel = error/scale if scale > 0. else error
+    print('%s: max error = %.3e' %(field, error_rel))
+    assert( error_rel < tolerance )
@@ -10,6 +10,7 @@
 
 #include "BoundaryConditions/PML.H"
 #include "BoundaryConditions/PMLComponent.H"
+#include "Diagnostics/RestartReader.H"
 #ifdef WARPX_USE_PSATD
 #   include "FieldSolver/SpectralSolver/SpectralFieldData.H"
 #endif
@@ -1398,31 +1399,31 @@ PML::Restart (const std::string& dir)
 {
     if (pml_E_fp[0])
     {
-        VisMF::Read(*pml_E_fp[0], dir+"_Ex_fp");
-        VisMF::Read(*pml_E_fp[1], dir+"_Ey_fp");
-        VisMF::Read(*pml_E_fp[2], dir+"_Ez_fp");
-        VisMF::Read(*pml_B_fp[0], dir+"_Bx_fp");
-        VisMF::Read(*pml_B_fp[1], dir+"_By_fp");
-        VisMF::Read(*pml_B_fp[2], dir+"_Bz_fp");
+        RestartReader::Read(*pml_E_fp[0], dir+"_Ex_fp");
+        RestartReader::Read(*pml_E_fp[1], dir+"_Ey_fp");
+        RestartReader::Read(*pml_E_fp[2], dir+"_Ez_fp");
+        RestartReader::Read(*pml_B_fp[0], dir+"_Bx_fp");
+        RestartReader::Read(*pml_B_fp[1], dir+"_By_fp");
+        RestartReader::Read(*pml_B_fp[2], dir+"_Bz_fp");
 #ifdef WARPX_MAG_LLG
-        VisMF::Read(*pml_H_fp[0], dir+"_Hx_fp");
-        VisMF::Read(*pml_H_fp[1], dir+"_Hy_fp");
-        VisMF::Read(*pml_H_fp[2], dir+"_Hz_fp");
+        RestartReader::Read(*pml_H_fp[0], dir+"_Hx_fp");
+        RestartReader::Read(*pml_H_fp[1], dir+"_Hy_fp");
+        RestartReader::Read(*pml_H_fp[2], dir+"_Hz_fp");
 #endif
     }
 
     if (pml_E_cp[0])
     {
-        VisMF::Read(*pml_E_cp[0], dir+"_Ex_cp");
-        VisMF::Read(*pml_E_cp[1], dir+"_Ey_cp");
-        VisMF::Read(*pml_E_cp[2], dir+"_Ez_cp");
-        VisMF::Read(*pml_B_cp[0], dir+"_Bx_cp");
-        VisMF::Read(*pml_B_cp[1], dir+"_By_cp");
-        VisMF::Read(*pml_B_cp[2], dir+"_Bz_cp");
+        RestartReader::Read(*pml_E_cp[0], dir+"_Ex_cp");
+        RestartReader::Read(*pml_E_cp[1], dir+"_Ey_cp");
+        RestartReader::Read(*pml_E_cp[2], dir+"_Ez_cp");
+        RestartReader::Read(*pml_B_cp[0], dir+"_Bx_cp");
+        RestartReader::Read(*pml_B_cp[1], dir+"_By_cp");
+        RestartReader::Read(*pml_B_cp[2], dir+"_Bz_cp");
 #ifdef WARPX_MAG_LLG
-        VisMF::Read(*pml_H_cp[0], dir+"_Hx_cp");
-        VisMF::Read(*pml_H_cp[1], dir+"_Hy_cp");
-        VisMF::Read(*pml_H_cp[2], dir+"_Hz_cp");
+        RestartReader::Read(*pml_H_cp[0], dir+"_Hx_cp");
+        RestartReader::Read(*pml_H_cp[1], dir+"_Hy_cp");
+        RestartReader::Read(*pml_H_cp[2], dir+"_Hz_cp");
 #endif
     }
 }
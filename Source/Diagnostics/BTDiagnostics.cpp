@@ -4,31 +4,47 @@
 #include "ComputeDiagFunctors/BackTransformFunctor.H"
 #include "ComputeDiagFunctors/CellCenterFunctor.H"
 #include "ComputeDiagFunctors/ComputeDiagFunctor.H"
+#include "ComputeDiagFunctors/FusedCellCenterFunctor.H"
 #include "ComputeDiagFunctors/RhoFunctor.H"
 #include "Diagnostics/Diagnostics.H"
 #include "Diagnostics/FlushFormats/FlushFormat.H"
+#include "Particles/MultiParticleContainer.H"
+#include "Particles/PinnedMemoryParticleContainer.H"
+#include "Particles/SpeciesPhysicalProperties.H"
+#include "Particles/WarpXParticleContainer.H"
 #include "Utils/CoarsenIO.H"
 #include "Utils/WarpXConst.H"
+#include "Utils/WarpXProfilerWrapper.H"
 #include "Utils/WarpXUtil.H"
 #include "WarpX.H"
 
 #include <AMReX.H>
 #include <AMReX_Algorithm.H>
+#include <AMReX_Arena.H>
+#include <AMReX_AsyncOut.H>
 #include <AMReX_BLassert.H>
 #include <AMReX_BoxArray.H>
+#include <AMReX_BoxList.H>
 #include <AMReX_Config.H>
 #include <AMReX_CoordSys.H>
 #include <AMReX_DistributionMapping.H>
 #include <AMReX_FileSystem.H>
+#include <AMReX_GpuContainers.H>
+#include <AMReX_GpuLaunch.H>
 #include <AMReX_ParallelContext.H>
 #include <AMReX_ParallelDescriptor.H>
 #include <AMReX_ParmParse.H>
+#include <AMReX_PlotFileUtil.H>
+#include <AMReX_Scan.H>
 #include <AMReX_Utility.H>
+#include <AMReX_VisMF.H>
 
 #include <algorithm>
 #include <cmath>
 #include <cstdio>
+#include <fstream>
 #include <memory>
+#include <string>
 #include <vector>
 
 using namespace amrex::literals;
@@ -130,6 +146,16 @@ BTDiagnostics::ReadParameters ()
     pp_diag_name.query("do_back_transformed_fields", m_do_back_transformed_fields);
     pp_diag_name.query("do_back_transformed_particles", m_do_back_transformed_particles);
     AMREX_ALWAYS_ASSERT(m_do_back_transformed_fields or m_do_back_transformed_particles);
+    if (m_do_back_transformed_particles) {
+        // The particles of a snapshot are written by the flush format with its last field buffer
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(m_do_back_transformed_fields,
+            m_diag_name + ".do_back_transformed_particles = 1 requires "
+            + m_diag_name + ".do_back_transformed_fields = 1");
+#ifdef WARPX_DIM_RZ
+        amrex::Abort(m_diag_name + ".do_back_transformed_particles = 1 is not supported in RZ geometry");
+#endif
+    }
+    queryWithParser(pp_diag_name, "particle_slice_width_lab", m_particle_slice_width_lab);
 
     pp_diag_name.get("num_snapshots_lab", m_num_snapshots_lab);
     m_num_buffers = m_num_snapshots_lab;
@@ -144,12 +170,29 @@ BTDiagnostics::ReadParameters ()
     AMREX_ALWAYS_ASSERT_WITH_MESSAGE(snapshot_interval_is_specified,
         "For back-transformed diagnostics, user should specify either dz_snapshots_lab or dt_snapshots_lab");
     // For BTD, we always need rho to perform Lorentz Transform of current-density
-    if (WarpXUtilStr::is_in(m_cellcenter_varnames, "rho")) warpx.setplot_rho(true);
+    if (m_do_back_transformed_fields && WarpXUtilStr::is_in(m_cellcenter_varnames, "rho")) {
+        warpx.setplot_rho(true);
+    }
 
     if (pp_diag_name.query("buffer_size", m_buffer_size)) {
         if(m_max_box_size < m_buffer_size) m_max_box_size = m_buffer_size;
     }
 
+    pp_diag_name.query("async_flush", m_async_flush);
+    if (m_async_flush) {
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(m_format == "plotfile",
+            m_diag_name + ".async_flush = 1 requires format = plotfile for back-transformed diagnostics");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(amrex::AsyncOut::UseAsyncOut(),
+            m_diag_name + ".async_flush = 1 requires amrex.async_out = 1");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(!m_do_back_transformed_particles,
+            m_diag_name + ".async_flush = 1 is not supported with "
+            + m_diag_name + ".do_back_transformed_particles = 1");
+        std::string precision = "double";
+        pp_diag_name.query("precision", precision);
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(precision == "double",
+            m_diag_name + ".async_flush = 1 is not supported with " + m_diag_name + ".precision = single");
+    }
+
 }
 
 bool
@@ -382,7 +425,8 @@ BTDiagnostics::InitializeFieldFunctors (int lev)
             m_cell_center_functors[lev][comp] = std::make_unique<RhoFunctor>(lev, m_crse_ratio);
         }
     }
-
+    // Cell-center E, B and j in a single pass
+    FuseCellCenterFunctors( m_cell_center_functors[lev], lev, m_crse_ratio );
 }
 
 void
@@ -392,26 +436,29 @@ BTDiagnostics::PrepareFieldDataForOutput ()
     // In this function, we will get cell-centered data for every level, lev,
     // using the cell-center functors and their respective opeators()
     // Call m_cell_center_functors->operator
-    for (int lev = 0; lev < nmax_lev; ++lev) {
-        int icomp_dst = 0;
-        for (int icomp = 0, n=m_cell_center_functors[0].size(); icomp<n; ++icomp) {
-            // Call all the cell-center functors in m_cell_center_functors.
-            // Each of them computes cell-centered data for a field and
-            // stores it in cell-centered MultiFab, m_cell_centered_data[lev].
-            m_cell_center_functors[lev][icomp]->operator()(*m_cell_centered_data[lev], icomp_dst);
-            icomp_dst += m_cell_center_functors[lev][icomp]->nComp();
+    // When only particles are back-transformed, the buffer counters are still updated below
+    if (m_do_back_transformed_fields) {
+        for (int lev = 0; lev < nmax_lev; ++lev) {
+            int icomp_dst = 0;
+            for (int icomp = 0, n=m_cell_center_functors[0].size(); icomp<n; ++icomp) {
+                // Call all the cell-center functors in m_cell_center_functors.
+                // Each of them computes cell-centered data for a field and
+                // stores it in cell-centered MultiFab, m_cell_centered_data[lev].
+                m_cell_center_functors[lev][icomp]->operator()(*m_cell_centered_data[lev], icomp_dst);
+                icomp_dst += m_cell_center_functors[lev][icomp]->nComp();
+            }
+            // Check that the proper number of user-requested components are cell-centered
+            AMREX_ALWAYS_ASSERT( icomp_dst == m_cellcenter_varnames.size() );
+            // fill boundary call is required to average_down (flatten) data to
+            // the coarsest level.
+            m_cell_centered_data[lev]->FillBoundary(warpx.Geom(lev).periodicity() );
         }
-        // Check that the proper number of user-requested components are cell-centered
-        AMREX_ALWAYS_ASSERT( icomp_dst == m_cellcenter_varnames.size() );
-        // fill boundary call is required to average_down (flatten) data to
-        // the coarsest level.
-        m_cell_centered_data[lev]->FillBoundary(warpx.Geom(lev).periodicity() );
-    }
-    // Flattening out MF over levels
+        // Flattening out MF over levels
 
-    for (int lev = warpx.finestLevel(); lev > 0; --lev) {
-        CoarsenIO::Coarsen( *m_cell_centered_data[lev-1], *m_cell_centered_data[lev], 0, 0,
-                             m_cellcenter_varnames.size(), 0, WarpX::RefRatio(lev-1) );
+        for (int lev = warpx.finestLevel(); lev > 0; --lev) {
+            CoarsenIO::Coarsen( *m_cell_centered_data[lev-1], *m_cell_centered_data[lev], 0, 0,
+                                 m_cellcenter_varnames.size(), 0, WarpX::RefRatio(lev-1) );
+        }
     }
 
     int num_BT_functors = 1;
@@ -441,13 +488,15 @@ BTDiagnostics::PrepareFieldDataForOutput ()
                     }
                 }
                 m_all_field_functors[lev][i]->PrepareFunctorData (
-                                             i_buffer, ZSliceInDomain,
+                                             i_buffer, ZSliceInDomain && m_do_back_transformed_fields,
                                              m_current_z_boost[i_buffer],
                                              m_buffer_box[i_buffer],
                                              k_index_zlab(i_buffer, lev), m_max_box_size );
 
                 if (ZSliceInDomain) ++m_buffer_counter[i_buffer];
             }
+            // Back-transform the z-slices of all the snapshots together
+            m_all_field_functors[lev][i]->BatchPrepareFunctorData();
         }
     }
 
@@ -604,31 +653,276 @@ BTDiagnostics::GetZSliceInDomainFlag (const int i_buffer, const int lev)
 }
 
 void
-BTDiagnostics::Flush (int i_buffer)
+BTDiagnostics::Flush (int i_buffer, bool force_flush)
 {
-    auto & warpx = WarpX::GetInstance();
-    std::string file_name = m_file_prefix;
-    if (m_format=="plotfile") {
-        file_name = amrex::Concatenate(m_file_prefix,i_buffer,5);
-        file_name = file_name+"/buffer";
-    }
-    bool isLastBTDFlush = ( ( m_max_buffer_multifabs[i_buffer]
-                               - m_buffer_flush_counter[i_buffer]) == 1) ? true : false;
-    bool const isBTD = true;
-    double const labtime = m_t_lab[i_buffer];
-    m_flush_format->WriteToFile(
-        m_varnames, m_mf_output[i_buffer], m_geom_output[i_buffer], warpx.getistep(),
-        labtime, m_output_species, nlev_output, file_name, m_file_min_digits,
-        m_plot_raw_fields, m_plot_raw_fields_guards, m_plot_raw_rho, m_plot_raw_F,
-        isBTD, i_buffer, m_geom_snapshot[i_buffer][0], isLastBTDFlush);
-
-    if (m_format == "plotfile") {
-        MergeBuffersForPlotfile(i_buffer);
+    if (m_do_back_transformed_fields) {
+        if (m_async_flush) {
+            FlushBufferAsync(i_buffer);
+        } else {
+            auto & warpx = WarpX::GetInstance();
+            std::string file_name = m_file_prefix;
+            if (m_format=="plotfile") {
+                file_name = amrex::Concatenate(m_file_prefix,i_buffer,5);
+                file_name = file_name+"/buffer";
+            }
+            bool isLastBTDFlush = ( ( m_max_buffer_multifabs[i_buffer]
+                                       - m_buffer_flush_counter[i_buffer]) == 1) ? true : false;
+            bool const isBTD = true;
+            double const labtime = m_t_lab[i_buffer];
+            // Each species is written once per snapshot, when no more particles are added to it
+            const bool write_particles = m_do_back_transformed_particles
+                                         && (isLastBTDFlush || force_flush);
+            const amrex::Vector<ParticleDiag> no_species;
+            m_flush_format->WriteToFile(
+                m_varnames, m_mf_output[i_buffer], m_geom_output[i_buffer], warpx.getistep(),
+                labtime, write_particles ? m_output_species_buffer[i_buffer] : no_species,
+                nlev_output, file_name, m_file_min_digits,
+                m_plot_raw_fields, m_plot_raw_fields_guards, m_plot_raw_rho, m_plot_raw_F,
+                isBTD, i_buffer, m_geom_snapshot[i_buffer][0], isLastBTDFlush);
+
+            if (m_format == "plotfile") {
+                MergeBuffersForPlotfile(i_buffer);
+            }
+
+            if (write_particles) {
+                // Release the particle buffers of the snapshot
+                for (auto& pc : m_particles_buffer[i_buffer]) pc->clearParticles();
+            }
+        }
     }
 
     // Reset the buffer counter to zero after flushing out data stored in the buffer.
     ResetBufferCounter(i_buffer);
     IncrementBufferFlushCounter(i_buffer);
+    // The buffer is defined again when the next slice of this snapshot is back-transformed
+    ReleaseFieldBuffer(i_buffer);
+}
+
+void
+BTDiagnostics::FlushBufferAsync (int i_buffer)
+{
+    WARPX_PROFILE("BTDiagnostics::FlushBufferAsync()");
+    auto & warpx = WarpX::GetInstance();
+    // BTD data is always flattened to a single level
+    const int lev = 0;
+    const int flush_counter = m_buffer_flush_counter[i_buffer];
+    const std::string snapshot_path = amrex::Concatenate(m_file_prefix, i_buffer, 5);
+    const std::string snapshot_Level0_path = snapshot_path + "/Level_0";
+    const std::string buffer_name = amrex::Concatenate("Buffer_", flush_counter, 5);
+    amrex::Print() << "  Appending buffer " << flush_counter << " to " << snapshot_path << "\n";
+
+    if (flush_counter == 0) {
+        if (amrex::ParallelDescriptor::IOProcessor()) {
+            if (!amrex::UtilCreateDirectory(snapshot_Level0_path, 0755))
+                amrex::CreateDirectoryFailed(snapshot_Level0_path);
+        }
+        // All ranks write their part of the buffers in Level_0
+        amrex::ParallelDescriptor::Barrier();
+    }
+
+    if (amrex::ParallelDescriptor::IOProcessor()) {
+        // The plotfile Header only depends on the meta-data of the buffer: update it right away
+        const std::string snapshot_Header_filename = snapshot_path + "/Header";
+        const std::string buffer_Header_filename = (flush_counter == 0) ?
+            snapshot_Header_filename : snapshot_path + "/Header_" + buffer_name;
+        std::ofstream HeaderFile(buffer_Header_filename.c_str(), std::ofstream::out   |
+                                                                 std::ofstream::trunc |
+                                                                 std::ofstream::binary);
+        if (!HeaderFile.good()) amrex::FileOpenFailed(buffer_Header_filename);
+        const amrex::Vector<amrex::BoxArray> boxArrays {m_mf_output[i_buffer][lev].boxArray()};
+        amrex::WriteGenericPlotfileHeader(HeaderFile, nlev_output, boxArrays, m_varnames,
+                                          m_geom_output[i_buffer],
+                                          static_cast<amrex::Real>(m_t_lab[i_buffer]),
+                                          warpx.getistep(), warpx.refRatio(),
+                                          "HyperCLaw-V1.1", "Level_", "Cell");
+        HeaderFile.close();
+        if (flush_counter > 0) {
+            InterleaveBufferAndSnapshotHeader(buffer_Header_filename, snapshot_Header_filename);
+            std::remove(buffer_Header_filename.c_str());
+        }
+    }
+
+    // Stage the buffer in pinned host memory. The staging MultiFab is moved to the
+    // I/O thread, so that the buffer itself can be released and refilled right away.
+    const amrex::MultiFab& mf = m_mf_output[i_buffer][lev];
+    amrex::MultiFab staging(mf.boxArray(), mf.DistributionMap(), mf.nComp(), 0,
+                            amrex::MFInfo().SetArena(amrex::The_Pinned_Arena()));
+    amrex::MultiFab::Copy(staging, mf, 0, 0, mf.nComp(), 0);
+    amrex::VisMF::AsyncWrite(std::move(staging), snapshot_Level0_path + "/" + buffer_name, true);
+
+    if (amrex::ParallelDescriptor::IOProcessor()) {
+        // Tasks run in order on the I/O thread: the header of the buffer written above
+        // exists when this task runs. The data files keep their names, Buffer_<n>_D_*.
+        const std::string buffer_FabHeader_filename = snapshot_Level0_path + "/" + buffer_name + "_H";
+        const std::string snapshot_FabHeader_filename = snapshot_Level0_path + "/Cell_H";
+        amrex::AsyncOut::Submit([=] ()
+        {
+            if (flush_counter == 0) {
+                std::rename(buffer_FabHeader_filename.c_str(), snapshot_FabHeader_filename.c_str());
+            } else {
+                InterleaveFabArrayHeader(buffer_FabHeader_filename, snapshot_FabHeader_filename, "");
+                std::remove(buffer_FabHeader_filename.c_str());
+            }
+        });
+    }
+}
+
+void
+BTDiagnostics::ReleaseFieldBuffer (int i_buffer)
+{
+    for (int lev = 0; lev < nlev_output; ++lev) {
+        m_mf_output[i_buffer][lev] = amrex::MultiFab();
+    }
+}
+
+void
+BTDiagnostics::InitializeParticleBuffer ()
+{
+    auto & warpx = WarpX::GetInstance();
+    const MultiParticleContainer& mypc = warpx.GetPartContainer();
+    const int nspecies = m_do_back_transformed_particles ?
+        mypc.nSpeciesBackTransformedDiagnostics() : 0;
+    const std::vector<std::string> species_names = mypc.GetSpeciesNames();
+
+    // The buffers do not follow the simulation grids: each rank owns one box, so that
+    // the particles it back-transforms always stay on this rank until they are written.
+    const int nprocs = amrex::ParallelDescriptor::NProcs();
+    amrex::BoxList bl;
+    amrex::Vector<int> pmap(nprocs);
+    for (int iproc = 0; iproc < nprocs; ++iproc) {
+        bl.push_back(amrex::Box(amrex::IntVect(iproc), amrex::IntVect(iproc)));
+        pmap[iproc] = iproc;
+    }
+    const amrex::BoxArray ba(bl);
+    const amrex::DistributionMapping dm(pmap);
+
+    m_particles_buffer.resize(m_num_buffers);
+    m_output_species_buffer.resize(m_num_buffers);
+    for (int i_buffer = 0; i_buffer < m_num_buffers; ++i_buffer) {
+        for (int isp = 0; isp < nspecies; ++isp) {
+            const int idx = mypc.mapSpeciesBackTransformedDiagnostics(isp);
+            m_particles_buffer[i_buffer].push_back(
+                std::make_unique<PinnedMemoryParticleContainer>(warpx.Geom(0), dm, ba));
+            m_output_species_buffer[i_buffer].push_back(
+                ParticleDiag(m_diag_name, species_names[idx], mypc.GetParticleContainerPtr(idx),
+                             m_particles_buffer[i_buffer][isp].get()));
+            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(!m_output_species_buffer[i_buffer][isp].DoFilter(),
+                "Particle filters are not supported for back-transformed diagnostics ("
+                + m_diag_name + "." + species_names[idx] + ")");
+        }
+    }
+}
+
+void
+BTDiagnostics::BackTransformParticles (amrex::Real t_boost, amrex::Real dt)
+{
+    if (!m_do_back_transformed_particles) return;
+    WARPX_PROFILE("BTDiagnostics::BackTransformParticles()");
+    auto & warpx = WarpX::GetInstance();
+    const MultiParticleContainer& mypc = warpx.GetPartContainer();
+    const int nspecies = mypc.nSpeciesBackTransformedDiagnostics();
+    if (nspecies == 0) return;
+    // BTD data is always flattened to a single level
+    const int lev = 0;
+    const amrex::RealBox& boost_domain = warpx.Geom(lev).ProbDomain();
+    const int myproc = amrex::ParallelDescriptor::MyProc();
+
+    for (int i_buffer = 0; i_buffer < m_num_buffers; ++i_buffer) {
+        // z-boost location of the snapshot before and after the push
+        const amrex::Real z_old_boost = UpdateCurrentZBoostCoordinate(m_t_lab[i_buffer], t_boost - dt);
+        const amrex::Real z_new_boost = UpdateCurrentZBoostCoordinate(m_t_lab[i_buffer], t_boost);
+        const amrex::Real z_lab = UpdateCurrentZLabCoordinate(m_t_lab[i_buffer], t_boost);
+        if ( ( z_new_boost < boost_domain.lo(m_moving_window_dir) ) or
+             ( z_new_boost > boost_domain.hi(m_moving_window_dir) ) or
+             ( z_lab < m_snapshot_domain_lab[i_buffer].lo(m_moving_window_dir) ) or
+             ( z_lab > m_snapshot_domain_lab[i_buffer].hi(m_moving_window_dir) ) ) continue;
+
+        // Particles that crossed the z-boost location of the snapshot, in the lab-frame
+        amrex::Vector<WarpXParticleContainer::DiagnosticParticleData> slice_particles(nspecies);
+        mypc.GetLabFrameData(m_file_prefix, i_buffer, m_moving_window_dir, z_old_boost,
+                             z_new_boost, t_boost, m_t_lab[i_buffer], dt, slice_particles);
+
+        // Transverse extent of the diagnostics, plus the user-defined width
+        const amrex::Real xmin = m_snapshot_domain_lab[i_buffer].lo(0) - m_particle_slice_width_lab;
+        const amrex::Real xmax = m_snapshot_domain_lab[i_buffer].hi(0) + m_particle_slice_width_lab;
+#if (AMREX_SPACEDIM == 3)
+        const amrex::Real ymin = m_snapshot_domain_lab[i_buffer].lo(1) - m_particle_slice_width_lab;
+        const amrex::Real ymax = m_snapshot_domain_lab[i_buffer].hi(1) + m_particle_slice_width_lab;
+#endif
+        for (int isp = 0; isp < nspecies; ++isp) {
+            const auto& src = slice_particles[isp];
+            const int np = static_cast<int>(src.GetRealData(DiagIdx::w).size());
+            if (np == 0) continue;
+
+            // Flag the particles within the transverse extent of the diagnostics
+            amrex::Gpu::DeviceVector<int> FlagForPartCopy(np);
+            amrex::Gpu::DeviceVector<int> IndexForPartCopy(np);
+            int* const AMREX_RESTRICT Flag = FlagForPartCopy.dataPtr();
+            int* const AMREX_RESTRICT IndexLocation = IndexForPartCopy.dataPtr();
+            amrex::ParticleReal const* const AMREX_RESTRICT x = src.GetRealData(DiagIdx::x).data();
+#if (AMREX_SPACEDIM == 3)
+            amrex::ParticleReal const* const AMREX_RESTRICT y = src.GetRealData(DiagIdx::y).data();
+#endif
+            amrex::ParallelFor(np,
+                [=] AMREX_GPU_DEVICE (int ip)
+                {
+                    Flag[ip] = 0;
+                    if ( x[ip] >= xmin && x[ip] <= xmax
+#if (AMREX_SPACEDIM == 3)
+                         && y[ip] >= ymin && y[ip] <= ymax
+#endif
+                       ) {
+                        Flag[ip] = 1;
+                    }
+                });
+            const int copy_size = amrex::Scan::ExclusiveSum(np, Flag, IndexLocation);
+            if (copy_size == 0) continue;
+
+            // Append the flagged particles to the tile of this rank in the buffer of the
+            // snapshot, in SI units. The ids are unique on each rank, which is stored in cpu.
+            // As in ConvertUnits, the momentum of photons is normalized with the electron mass
+            const auto& pc = mypc.GetParticleContainer(mypc.mapSpeciesBackTransformedDiagnostics(isp));
+            const amrex::ParticleReal mass =
+                pc.AmIA<PhysicalSpecies::photon>() ? PhysConst::m_e : pc.getMass();
+            auto& ptile = m_particles_buffer[i_buffer][isp]->DefineAndReturnParticleTile(lev, myproc, 0);
+            const int init_size = static_cast<int>(ptile.numParticles());
+            ptile.resize(init_size + copy_size);
+            auto* const AMREX_RESTRICT pstruct = ptile.GetArrayOfStructs()().data();
+            auto& soa = ptile.GetStructOfArrays();
+            amrex::ParticleReal* const AMREX_RESTRICT w_dst = soa.GetRealData(PIdx::w).data();
+            amrex::ParticleReal* const AMREX_RESTRICT ux_dst = soa.GetRealData(PIdx::ux).data();
+            amrex::ParticleReal* const AMREX_RESTRICT uy_dst = soa.GetRealData(PIdx::uy).data();
+            amrex::ParticleReal* const AMREX_RESTRICT uz_dst = soa.GetRealData(PIdx::uz).data();
+            amrex::ParticleReal const* const AMREX_RESTRICT w = src.GetRealData(DiagIdx::w).data();
+            amrex::ParticleReal const* const AMREX_RESTRICT z = src.GetRealData(DiagIdx::z).data();
+            amrex::ParticleReal const* const AMREX_RESTRICT ux = src.GetRealData(DiagIdx::ux).data();
+            amrex::ParticleReal const* const AMREX_RESTRICT uy = src.GetRealData(DiagIdx::uy).data();
+            amrex::ParticleReal const* const AMREX_RESTRICT uz = src.GetRealData(DiagIdx::uz).data();
+            amrex::ParallelFor(np,
+                [=] AMREX_GPU_DEVICE (int ip)
+                {
+                    if (Flag[ip] == 1) {
+                        const int loc = init_size + IndexLocation[ip];
+                        auto& p = pstruct[loc];
+                        p.id() = loc + 1;
+                        p.cpu() = myproc;
+#if (AMREX_SPACEDIM == 3)
+                        p.pos(0) = x[ip];
+                        p.pos(1) = y[ip];
+                        p.pos(2) = z[ip];
+#else
+                        p.pos(0) = x[ip];
+                        p.pos(1) = z[ip];
+#endif
+                        w_dst[loc] = w[ip];
+                        ux_dst[loc] = mass * ux[ip];
+                        uy_dst[loc] = mass * uy[ip];
+                        uz_dst[loc] = mass * uz[ip];
+                    }
+                });
+            amrex::Gpu::synchronize();
+        }
+    }
 }
 
 void BTDiagnostics::TMP_ClearSpeciesDataForBTD ()
@@ -641,6 +935,12 @@ void BTDiagnostics::MergeBuffersForPlotfile (int i_snapshot)
 {
     auto & warpx = WarpX::GetInstance();
     const amrex::Vector<int> iteration = warpx.getistep();
+    if (amrex::AsyncOut::UseAsyncOut()) {
+        // The particles of the buffer are written in the background by all the ranks:
+        // wait until they are on disk before moving them to the snapshot
+        amrex::AsyncOut::Finish();
+        amrex::ParallelDescriptor::Barrier();
+    }
     if (amrex::ParallelContext::IOProcessorSub()) {
         // Path to final snapshot plotfiles
         std::string snapshot_path = amrex::Concatenate(m_file_prefix,i_snapshot,5);
@@ -694,6 +994,15 @@ void BTDiagnostics::MergeBuffersForPlotfile (int i_snapshot)
             std::rename(recent_Buffer_FabFilename.c_str(),
                         snapshot_FabFilename.c_str());
         }
+        // Move the back-transformed particles, written with the last buffer, to the snapshot
+        for (const auto& species_diag : m_output_species_buffer[i_snapshot]) {
+            const std::string species_name = species_diag.getSpeciesName();
+            const std::string buffer_species_path = recent_Buffer_filepath + "/" + species_name;
+            if (amrex::FileSystem::Exists(buffer_species_path)) {
+                const std::string snapshot_species_path = snapshot_path + "/" + species_name;
+                std::rename(buffer_species_path.c_str(), snapshot_species_path.c_str());
+            }
+        }
         // Destroying the recently flushed buffer directory since it is already merged.
         amrex::FileSystem::RemoveAll(recent_Buffer_filepath);
 
@@ -736,11 +1045,12 @@ BTDiagnostics::InterleaveBufferAndSnapshotHeader ( std::string buffer_Header_pat
     amrex::Box domain_box(box_lo, box_hi);
     snapshot_HeaderImpl.set_probDomain(domain_box);
 
-    // Increment numFabs
-    snapshot_HeaderImpl.IncrementNumFabs();
-    // The number of fabs in the recently written buffer is always 1.
-    snapshot_HeaderImpl.AppendNewFabLo( buffer_HeaderImpl.FabLo(0));
-    snapshot_HeaderImpl.AppendNewFabHi( buffer_HeaderImpl.FabHi(0));
+    // Append all the fabs of the recently written buffer
+    for (int ifab = 0; ifab < buffer_HeaderImpl.numFabs(); ++ifab) {
+        snapshot_HeaderImpl.IncrementNumFabs();
+        snapshot_HeaderImpl.AppendNewFabLo( buffer_HeaderImpl.FabLo(ifab));
+        snapshot_HeaderImpl.AppendNewFabHi( buffer_HeaderImpl.FabHi(ifab));
+    }
 
     snapshot_HeaderImpl.WriteHeader();
 }
@@ -762,12 +1072,13 @@ BTDiagnostics::InterleaveFabArrayHeader(std::string Buffer_FabHeader_path,
     snapshot_FabHeader.ResizeFabData();
 
     for (int ifab = 0; ifab < Buffer_FabHeader.ba_size(); ++ifab) {
-        int new_ifab = snapshot_FabHeader.ba_size() - 1 + ifab;
+        int new_ifab = snapshot_FabHeader.ba_size() - Buffer_FabHeader.ba_size() + ifab;
         snapshot_FabHeader.SetBox(new_ifab, Buffer_FabHeader.ba_box(ifab) );
-        // Set Name of the new fab using newsnapshot_FabFilename.
+        // Set Name of the new fab using newsnapshot_FabFilename, if provided.
         snapshot_FabHeader.SetFabName(new_ifab, Buffer_FabHeader.fodPrefix(ifab),
-                                                newsnapshot_FabFilename,
-                                                Buffer_FabHeader.FabHead(ifab) );
+                                      newsnapshot_FabFilename.empty() ?
+                                          Buffer_FabHeader.FabName(ifab) : newsnapshot_FabFilename,
+                                      Buffer_FabHeader.FabHead(ifab) );
         snapshot_FabHeader.SetMinVal(new_ifab, Buffer_FabHeader.minval(ifab));
         snapshot_FabHeader.SetMaxVal(new_ifab, Buffer_FabHeader.maxval(ifab));
     }
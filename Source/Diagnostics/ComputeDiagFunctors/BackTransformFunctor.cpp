@@ -6,17 +6,21 @@
 
 #include <AMReX_Array4.H>
 #include <AMReX_BoxArray.H>
+#include <AMReX_BoxList.H>
 #include <AMReX_Config.H>
+#include <AMReX_DistributionMapping.H>
 #include <AMReX_FArrayBox.H>
 #include <AMReX_FabArray.H>
 #include <AMReX_Geometry.H>
+#include <AMReX_GpuAsyncArray.H>
+#include <AMReX_GpuContainers.H>
 #include <AMReX_GpuControl.H>
 #include <AMReX_GpuLaunch.H>
 #include <AMReX_GpuQualifiers.H>
 #include <AMReX_MFIter.H>
 #include <AMReX_MultiFab.H>
-#include <AMReX_MultiFabUtil.H>
 
+#include <algorithm>
 #include <cmath>
 #include <map>
 #include <memory>
@@ -32,86 +36,180 @@ BackTransformFunctor::BackTransformFunctor (amrex::MultiFab const * mf_src, int
     InitData();
 }
 
+namespace
+{
+    /** Lab-frame slice of one buffer, as needed by the back-transform kernel */
+    struct SliceBatchData
+    {
+        /** Data of the slice in the current box, in the lab-frame index space */
+        amrex::Array4<amrex::Real> dst;
+        /** Boosted-frame cells, in the moving window direction, between which
+         *  the fields are interpolated at z-boost */
+        int k0;
+        int k1;
+        /** Interpolation weight of cell k1 */
+        amrex::Real w;
+        /** Lab-frame index of the slice in the moving window direction */
+        int k_lab;
+    };
+}
+
 void
-BackTransformFunctor::operator ()(amrex::MultiFab& mf_dst, int /*dcomp*/, const int i_buffer) const
+BackTransformFunctor::operator ()(amrex::MultiFab& mf_dst, int dcomp, const int i_buffer) const
 {
-    // Perform back-transformation only if z slice is within the domain stored as 0/1
-    // in m_perform_backtransform[i_buffer]
-    if ( m_perform_backtransform[i_buffer] == 1) {
-        auto& warpx = WarpX::GetInstance();
-        auto geom = warpx.Geom(m_lev);
-        amrex::Real gamma_boost = warpx.gamma_boost;
-        int moving_window_dir = warpx.moving_window_dir;
-        amrex::Real beta_boost = std::sqrt( 1._rt - 1._rt/( gamma_boost * gamma_boost) );
-        bool interpolate = true;
-        std::unique_ptr< amrex::MultiFab > slice = nullptr;
-        int scomp = 0;
-        // Generate slice of the cell-centered multifab containing boosted-frame field-data
-        // at current z-boost location for the ith buffer
-        slice =  amrex::get_slice_data (moving_window_dir, m_current_z_boost[i_buffer],
-                     *m_mf_src, geom, scomp, m_mf_src->nComp(), interpolate);
-        // Perform in-place Lorentz-transform of all the fields stored in the slice.
-        LorentzTransformZ( *slice, gamma_boost, beta_boost);
-
-        // Create a 2D box for the slice in the boosted frame
-        amrex::Real dx = geom.CellSize(moving_window_dir);
-        // index corresponding to z_boost location in the boost-frame
-        int i_boost = static_cast<int> ( ( m_current_z_boost[i_buffer]
-                                            - geom.ProbLo(moving_window_dir) ) / dx );
-        // z-Slice at i_boost with x,y indices same as buffer_box
-        amrex::Box slice_box = m_buffer_box[i_buffer];
-        slice_box.setSmall(moving_window_dir, i_boost);
-        slice_box.setBig(moving_window_dir, i_boost);
-
-        // Make it a BoxArray
-        amrex::BoxArray slice_ba(slice_box);
-        slice_ba.maxSize( m_max_box_size );
-        // Define MultiFab with the distribution map of the destination multifab and
-        // containing all ten components that were in the slice generated from m_mf_src.
-        std::unique_ptr< amrex::MultiFab > tmp_slice_ptr = nullptr;
-        tmp_slice_ptr = std::make_unique<MultiFab> ( slice_ba, mf_dst.DistributionMap(),
-                                            slice->nComp(), 0 );
-        // Parallel copy the lab-frame data from "slice" MultiFab with
-        // ncomp=10 and boosted-frame dmap to "tmp_slice_ptr" MultiFab with
-        // ncomp=10 and dmap of the destination Multifab, which will store the final data
-        tmp_slice_ptr->ParallelCopy( *slice, 0, 0, slice->nComp() );
-        // Now we will cherry pick only the user-defined fields from
-        // tmp_slice_ptr to dst_mf
-        const int k_lab = m_k_index_zlab[i_buffer];
-        const int ncomp_dst = mf_dst.nComp();
-        amrex::MultiFab& tmp = *tmp_slice_ptr;
-#ifdef AMREX_USE_GPU
-        Gpu::DeviceVector<int> d_map_varnames(m_map_varnames.size());
-        Gpu::copyAsync(Gpu::hostToDevice,
-                       m_map_varnames.begin(), m_map_varnames.end(),
-                       d_map_varnames.begin());
-        Gpu::synchronize();
-        int const* field_map_ptr = d_map_varnames.dataPtr();
+    // The slice exists only if z slice is within the domain, i.e., if
+    // m_perform_backtransform[i_buffer] == 1, and was back-transformed
+    // in BatchPrepareFunctorData. Copy it to the distribution mapping of the buffer.
+    if ( m_slice[i_buffer] ) {
+        mf_dst.ParallelCopy( *m_slice[i_buffer], 0, dcomp, nComp() );
+    }
+}
+
+void
+BackTransformFunctor::BatchPrepareFunctorData ()
+{
+    // Release the slices of the previous step
+    for (auto& slice : m_slice) slice = nullptr;
+
+    auto& warpx = WarpX::GetInstance();
+    const amrex::Geometry& geom = warpx.Geom(m_lev);
+    const int moving_window_dir = warpx.moving_window_dir;
+    const amrex::Real gamma_boost = warpx.gamma_boost;
+    const amrex::Real beta_boost = std::sqrt( 1._rt - 1._rt/( gamma_boost * gamma_boost) );
+    const amrex::Real dz = geom.CellSize(moving_window_dir);
+    const int dom_lo = geom.Domain().smallEnd(moving_window_dir);
+    const int dom_hi = geom.Domain().bigEnd(moving_window_dir);
+    const amrex::BoxArray& src_ba = m_mf_src->boxArray();
+    const amrex::DistributionMapping& src_dm = m_mf_src->DistributionMap();
+
+    // For each buffer: cells between which the fields are interpolated,
+    // and index of the fab of the slice for each box of m_mf_src (-1 if none)
+    amrex::Vector<int> k0(m_num_buffers), k1(m_num_buffers);
+    amrex::Vector<amrex::Real> weight(m_num_buffers);
+    amrex::Vector<amrex::Vector<int>> slice_index(m_num_buffers);
+    bool any_slice = false;
+    for (int i_buffer = 0; i_buffer < m_num_buffers; ++i_buffer) {
+        if (m_perform_backtransform[i_buffer] == 0) continue;
+        // Linear interpolation between the two cell centers around z-boost,
+        // with constant extrapolation in the first and last half cells of the domain
+        const amrex::Real s = ( m_current_z_boost[i_buffer] - geom.ProbLo(moving_window_dir) ) / dz
+                              - 0.5_rt;
+        int klo = static_cast<int>( std::floor(s) );
+        amrex::Real w = s - klo;
+        if (klo < dom_lo) {
+            klo = dom_lo;
+            w = 0._rt;
+        } else if (klo >= dom_hi) {
+            klo = dom_hi;
+            w = 0._rt;
+        }
+        k0[i_buffer] = klo;
+        k1[i_buffer] = std::min(klo + 1, dom_hi);
+        weight[i_buffer] = w;
+
+        // The slice is made of the boxes of m_mf_src that contain cell k0, restricted
+        // to the transverse extent of the buffer. The cell k1 is then either in the same
+        // box or in its guard cells, which were filled by FillBoundary.
+        amrex::Box plane = m_buffer_box[i_buffer];
+        plane.setSmall(moving_window_dir, klo);
+        plane.setBig(moving_window_dir, klo);
+        amrex::BoxList slice_bl;
+        amrex::Vector<int> slice_procs;
+        slice_index[i_buffer].resize(src_ba.size(), -1);
+        for (int isrc = 0; isrc < src_ba.size(); ++isrc) {
+            amrex::Box bx = src_ba[isrc] & plane;
+            if (!bx.ok()) continue;
+            // Index of the lab-frame slice in the buffer
+            bx.setSmall(moving_window_dir, m_k_index_zlab[i_buffer]);
+            bx.setBig(moving_window_dir, m_k_index_zlab[i_buffer]);
+            slice_index[i_buffer][isrc] = static_cast<int>(slice_procs.size());
+            slice_bl.push_back(bx);
+            slice_procs.push_back(src_dm[isrc]);
+        }
+        if (slice_procs.empty()) continue;
+        m_slice[i_buffer] = std::make_unique<amrex::MultiFab>(
+            amrex::BoxArray(std::move(slice_bl)), amrex::DistributionMapping(slice_procs),
+            nComp(), 0);
+        any_slice = true;
+    }
+    if (!any_slice) return;
+
+    const int ncomp_dst = nComp();
+    int const* field_map_ptr = m_d_map_varnames.dataPtr();
+    const amrex::Real clight = PhysConst::c;
+    const amrex::Real inv_clight = 1.0_rt/clight;
+
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+    for (amrex::MFIter mfi(*m_mf_src, TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+        const amrex::Box& tbx = mfi.tilebox();
+        // One batch entry per buffer whose slice intersects this tile
+        amrex::Vector<SliceBatchData> h_batch;
+        for (int i_buffer = 0; i_buffer < m_num_buffers; ++i_buffer) {
+            if ( !m_slice[i_buffer] ) continue;
+            const int islice = slice_index[i_buffer][mfi.index()];
+            if ( islice < 0 ||
+                 k0[i_buffer] < tbx.smallEnd(moving_window_dir) ||
+                 k0[i_buffer] > tbx.bigEnd(moving_window_dir) ) continue;
+            h_batch.push_back({m_slice[i_buffer]->array(islice), k0[i_buffer], k1[i_buffer],
+                               weight[i_buffer], m_k_index_zlab[i_buffer]});
+        }
+        if (h_batch.empty()) continue;
+        const int nbatch = static_cast<int>(h_batch.size());
+        amrex::Gpu::AsyncArray<SliceBatchData> d_batch(h_batch.data(), nbatch);
+        SliceBatchData const* batch = d_batch.data();
+
+        // The index in the moving window direction is the index of the batch entry
+        amrex::Box bx = tbx;
+        bx.setSmall(moving_window_dir, 0);
+        bx.setBig(moving_window_dir, nbatch-1);
+        amrex::Array4<amrex::Real const> const src = m_mf_src->const_array(mfi);
+        amrex::ParallelFor( bx,
+            [=] AMREX_GPU_DEVICE (int i, int j, int k)
+            {
+#if (AMREX_SPACEDIM == 3)
+                SliceBatchData const& b = batch[k];
+                if ( !b.dst.contains(i, j, b.k_lab) ) return;
 #else
-        int const* field_map_ptr = m_map_varnames.dataPtr();
+                amrex::ignore_unused(k);
+                SliceBatchData const& b = batch[j];
+                if ( !b.dst.contains(i, b.k_lab, 0) ) return;
 #endif
-        for (amrex::MFIter mfi(tmp, TilingIfNotGPU()); mfi.isValid(); ++mfi)
-        {
-            const Box& tbx = mfi.tilebox();
-            amrex::Array4<amrex::Real> src_arr = tmp[mfi].array();
-            amrex::Array4<amrex::Real> dst_arr = mf_dst[mfi].array();
-            amrex::ParallelFor( tbx, ncomp_dst,
-                [=] AMREX_GPU_DEVICE(int i, int j, int k, int n)
-                {
-                    const int icomp = field_map_ptr[n];
+                // Interpolate Ex Ey Ez Bx By Bz jx jy jz rho, in that order, at z-boost
+                amrex::Real f[10];
+                for (int n = 0; n < 10; ++n) {
 #if (AMREX_SPACEDIM == 3)
-                    dst_arr(i, j, k_lab, n) = src_arr(i, j, k, icomp);
+                    f[n] = (1._rt - b.w) * src(i, j, b.k0, n) + b.w * src(i, j, b.k1, n);
 #else
-                    dst_arr(i, k_lab, k, n) = src_arr(i, j, k, icomp);
+                    f[n] = (1._rt - b.w) * src(i, b.k0, 0, n) + b.w * src(i, b.k1, 0, n);
 #endif
-                } );
-        }
-
-        // Reset the temporary MultiFabs generated
-        slice = nullptr;
-        tmp_slice_ptr = nullptr;
+                }
+                // Back-transform the transverse electric and magnetic fields.
+                // Note that the z-components, Ez, Bz, are not changed by the transform.
+                const amrex::Real ex_lab = gamma_boost * ( f[0] + beta_boost * clight * f[4] );
+                const amrex::Real by_lab = gamma_boost * ( f[4] + beta_boost * inv_clight * f[0] );
+                const amrex::Real ey_lab = gamma_boost * ( f[1] - beta_boost * clight * f[3] );
+                const amrex::Real bx_lab = gamma_boost * ( f[3] - beta_boost * inv_clight * f[1] );
+                // Transform charge density and z-component of current density
+                const amrex::Real jz_lab = gamma_boost * ( f[8] + beta_boost * clight * f[9] );
+                const amrex::Real rho_lab = gamma_boost * ( f[9] + beta_boost * inv_clight * f[8] );
+                f[0] = ex_lab;
+                f[1] = ey_lab;
+                f[3] = bx_lab;
+                f[4] = by_lab;
+                f[8] = jz_lab;
+                f[9] = rho_lab;
+                // Store only the user-requested fields
+                for (int n = 0; n < ncomp_dst; ++n) {
+#if (AMREX_SPACEDIM == 3)
+                    b.dst(i, j, b.k_lab, n) = f[field_map_ptr[n]];
+#else
+                    b.dst(i, b.k_lab, 0, n) = f[field_map_ptr[n]];
+#endif
+                }
+            });
     }
-
 }
 
 void
@@ -125,7 +223,8 @@ BackTransformFunctor::PrepareFunctorData (int i_buffer,
     m_k_index_zlab[i_buffer] = k_index_zlab;
     m_perform_backtransform[i_buffer] = 0;
     if (ZSliceInDomain) m_perform_backtransform[i_buffer] = 1;
-    m_max_box_size = max_box_size;
+    // The slices are defined on the boxes of the boosted-frame data
+    amrex::ignore_unused(max_box_size);
 }
 
 void
@@ -155,58 +254,9 @@ BackTransformFunctor::InitData ()
     {
         m_map_varnames[i] = m_possible_fields_to_dump[ m_varnames[i] ] ;
     }
+    m_d_map_varnames.resize( m_map_varnames.size() );
+    amrex::Gpu::copy(amrex::Gpu::hostToDevice, m_map_varnames.begin(), m_map_varnames.end(),
+                     m_d_map_varnames.begin());
 
-}
-
-void
-BackTransformFunctor::LorentzTransformZ (amrex::MultiFab& data, amrex::Real gamma_boost,
-                                         amrex::Real beta_boost) const
-{
-#ifdef AMREX_USE_OMP
-#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
-#endif
-    for (amrex::MFIter mfi(data, TilingIfNotGPU()); mfi.isValid(); ++mfi) {
-        const amrex::Box& tbx = mfi.tilebox();
-        amrex::Array4< amrex::Real > arr = data[mfi].array();
-        amrex::Real clight = PhysConst::c;
-        amrex::Real inv_clight = 1.0_rt/clight;
-        // arr(x,y,z,comp) has ten-components namely,
-        // Ex Ey Ez Bx By Bz jx jy jz rho in that order.
-        amrex::ParallelFor( tbx,
-            [=] AMREX_GPU_DEVICE (int i, int j, int k)
-            {
-                // Back-transform the transverse electric and magnetic fields.
-                // Note that the z-components, Ez, Bz, are not changed by the transform.
-                amrex::Real e_lab, b_lab, j_lab, rho_lab;
-                // Transform Ex_boost (ncomp=0) & By_boost (ncomp=4) to lab-frame
-                e_lab = gamma_boost * ( arr(i, j, k, 0)
-                                        + beta_boost * clight * arr(i, j, k, 4) );
-                b_lab = gamma_boost * ( arr(i, j, k, 4)
-                                        + beta_boost * inv_clight * arr(i, j, k, 0) );
-                // Store lab-frame data in-place
-                arr(i, j, k, 0) = e_lab;
-                arr(i, j, k, 4) = b_lab;
-
-                // Transform Ey_boost (ncomp=1) & Bx_boost (ncomp=3) to lab-frame
-                e_lab = gamma_boost * ( arr(i, j, k, 1)
-                                        - beta_boost * clight * arr(i, j, k, 3) );
-                b_lab = gamma_boost * ( arr(i, j, k, 3)
-                                        - beta_boost * inv_clight * arr(i, j, k, 1) );
-                // Store lab-frame data in-place
-                arr(i, j, k, 1) = e_lab;
-                arr(i, j, k, 3) = b_lab;
-
-                // Transform charge density (ncomp=9)
-                // and z-component of current density (ncomp=8)
-                j_lab = gamma_boost * ( arr(i, j, k, 8)
-                                        + beta_boost * clight * arr(i, j, k, 9) );
-                rho_lab = gamma_boost * ( arr(i, j, k, 9)
-                                          + beta_boost * inv_clight * arr(i, j, k, 8) );
-                // Store lab-frame jz and rho in-place
-                arr(i, j, k, 8) = j_lab;
-                arr(i, j, k, 9) = rho_lab;
-            }
-        );
-    }
-
+    m_slice.resize( m_num_buffers );
 }
@@ -0,0 +1,135 @@
+#include "FusedCellCenterFunctor.H"
+
+#include "Utils/CoarsenIO.H"
+
+#include <AMReX.H>
+#include <AMReX_Array.H>
+#include <AMReX_Array4.H>
+#include <AMReX_BLProfiler.H>
+#include <AMReX_BLassert.H>
+#include <AMReX_Box.H>
+#include <AMReX_BoxArray.H>
+#include <AMReX_DistributionMapping.H>
+#include <AMReX_GpuAsyncArray.H>
+#include <AMReX_GpuControl.H>
+#include <AMReX_GpuLaunch.H>
+#include <AMReX_GpuQualifiers.H>
+#include <AMReX_IndexType.H>
+#include <AMReX_IntVect.H>
+#include <AMReX_MFIter.H>
+#include <AMReX_MultiFab.H>
+
+namespace
+{
+    /** Source of one output component, as needed by the cell-centering kernel */
+    struct CellCenterSource
+    {
+        /** Data of the source multifab in the current box */
+        amrex::Array4<amrex::Real const> arr;
+        /** Staggering of the source multifab (always 3D) */
+        amrex::GpuArray<int,3> sf;
+        /** Component of the source multifab */
+        int scomp;
+    };
+
+    amrex::GpuArray<int,3> StaggeringToArray (const amrex::IntVect& stag)
+    {
+        amrex::GpuArray<int,3> s{0, 0, 0};
+        for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) s[idim] = stag[idim];
+        return s;
+    }
+}
+
+FusedCellCenterFunctor::FusedCellCenterFunctor (
+    const amrex::Vector<const amrex::MultiFab*>& mf_src,
+    const amrex::Vector<int>& scomp, int lev, amrex::IntVect crse_ratio)
+    : ComputeDiagFunctor(static_cast<int>(mf_src.size()), crse_ratio),
+      m_mf_src(mf_src), m_scomp(scomp), m_lev(lev)
+{
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
+        !m_mf_src.empty() && m_mf_src.size() == m_scomp.size(),
+        "FusedCellCenterFunctor needs one source component per output component");
+    for (const auto* mf : m_mf_src) {
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(AreCompatible(*m_mf_src[0], *mf),
+            "FusedCellCenterFunctor: all the source MultiFabs must have the same cells and DistributionMapping");
+    }
+}
+
+bool
+FusedCellCenterFunctor::AreCompatible (const amrex::MultiFab& mf_a, const amrex::MultiFab& mf_b)
+{
+    return mf_a.boxArray().CellEqual(mf_b.boxArray()) &&
+           mf_a.DistributionMap() == mf_b.DistributionMap();
+}
+
+void
+FusedCellCenterFunctor::operator()(amrex::MultiFab& mf_dst, int dcomp, const int /*i_buffer*/) const
+{
+    BL_PROFILE("FusedCellCenterFunctor()");
+    amrex::ignore_unused(m_lev);
+
+    // As in CellCenterFunctor, the guard cells of mf_dst are filled too, when possible
+    const amrex::IntVect ngrowvect = mf_dst.nGrowVect();
+
+    // Convert BoxArray of the sources to the staggering of mf_dst and coarsen it
+    amrex::BoxArray ba_tmp = amrex::convert( m_mf_src[0]->boxArray(), mf_dst.ixType().toIntVect() );
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE( ba_tmp.coarsenable( m_crse_ratio ),
+        "source MultiFab converted to staggering of destination MultiFab is not coarsenable" );
+    ba_tmp.coarsen( m_crse_ratio );
+
+    if ( ba_tmp == mf_dst.boxArray() && m_mf_src[0]->DistributionMap() == mf_dst.DistributionMap() ) {
+        Loop( mf_dst, dcomp, ngrowvect );
+    } else {
+        // Cannot coarsen into MultiFab with different BoxArray or DistributionMapping:
+        // compute all the components on the coarsened BoxArray of the sources,
+        // then copy them with a single ParallelCopy
+        amrex::MultiFab mf_tmp( ba_tmp, m_mf_src[0]->DistributionMap(), nComp(), 0 );
+        Loop( mf_tmp, 0, amrex::IntVect(0) );
+        mf_dst.ParallelCopy( mf_tmp, 0, dcomp, nComp() );
+    }
+}
+
+void
+FusedCellCenterFunctor::Loop (amrex::MultiFab& mf_dst, int dcomp, amrex::IntVect ngrowvect) const
+{
+    const amrex::IntVect stag_dst = mf_dst.boxArray().ixType().toIntVect();
+    if ( m_crse_ratio > amrex::IntVect(1) ) AMREX_ALWAYS_ASSERT_WITH_MESSAGE( ngrowvect == amrex::IntVect(0),
+        "option of filling guard cells of destination MultiFab with coarsening not supported for this interpolation" );
+    for (const auto* mf : m_mf_src) {
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
+            mf->nGrowVect() >= stag_dst - mf->boxArray().ixType().toIntVect() + ngrowvect,
+            "source fine MultiFab does not have enough guard cells for this interpolation" );
+    }
+
+    const amrex::GpuArray<int,3> sc = StaggeringToArray(stag_dst);
+    amrex::GpuArray<int,3> cr{1, 1, 1};
+    for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) cr[idim] = m_crse_ratio[idim];
+    const int nsrc = nComp();
+
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+    for (amrex::MFIter mfi( mf_dst, amrex::TilingIfNotGPU() ); mfi.isValid(); ++mfi)
+    {
+        // Tiles defined at the coarse level
+        const amrex::Box& bx = mfi.growntilebox( ngrowvect );
+        amrex::Array4<amrex::Real> const& arr_dst = mf_dst.array( mfi );
+        amrex::Vector<CellCenterSource> h_src(nsrc);
+        for (int n = 0; n < nsrc; ++n) {
+            h_src[n] = {m_mf_src[n]->const_array(mfi),
+                        StaggeringToArray(m_mf_src[n]->boxArray().ixType().toIntVect()),
+                        m_scomp[n]};
+        }
+        amrex::Gpu::AsyncArray<CellCenterSource> d_src(h_src.data(), nsrc);
+        CellCenterSource const* src = d_src.data();
+        // All the components of a cell are computed by the same thread
+        amrex::ParallelFor( bx,
+            [=] AMREX_GPU_DEVICE (int i, int j, int k)
+            {
+                for (int n = 0; n < nsrc; ++n) {
+                    arr_dst(i,j,k,n+dcomp) = CoarsenIO::Interp(
+                        src[n].arr, src[n].sf, sc, cr, i, j, k, src[n].scomp );
+                }
+            });
+    }
+}
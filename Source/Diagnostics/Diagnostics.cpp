@@ -5,6 +5,7 @@
 #include "Diagnostics/ParticleDiag/ParticleDiag.H"
 #include "FlushFormats/FlushFormatAscent.H"
 #include "FlushFormats/FlushFormatCheckpoint.H"
+#include "FlushFormats/FlushFormatInTransit.H"
 #ifdef WARPX_USE_OPENPMD
 #   include "FlushFormats/FlushFormatOpenPMD.H"
 #endif
@@ -52,6 +53,14 @@ Diagnostics::BaseReadParameters ()
     pp_diag_name.query("format", m_format);
     pp_diag_name.query("dump_last_timestep", m_dump_last_timestep);
 
+    // Optional compression of the output fields
+    m_field_compression = FieldCompression(m_diag_name);
+    // Without the lossless stage of the openPMD backend, quantized fields would only
+    // be less precise, and not smaller on disk
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
+        !m_field_compression.IsActive() || m_format == "openpmd",
+        m_diag_name + ".compression requires " + m_diag_name + ".format = openpmd");
+
     // Query list of grid fields to write to output
     bool varnames_specified = pp_diag_name.queryarr("fields_to_plot", m_varnames);
     if (!varnames_specified){
@@ -261,12 +270,14 @@ Diagnostics::InitBaseData ()
     }
     // Construct Flush class.
     if        (m_format == "plotfile"){
-        m_flush_format = std::make_unique<FlushFormatPlotfile>() ;
+        m_flush_format = std::make_unique<FlushFormatPlotfile>(m_diag_name) ;
     } else if (m_format == "checkpoint"){
         // creating checkpoint format
-        m_flush_format = std::make_unique<FlushFormatCheckpoint>() ;
+        m_flush_format = std::make_unique<FlushFormatCheckpoint>(m_diag_name) ;
     } else if (m_format == "ascent"){
         m_flush_format = std::make_unique<FlushFormatAscent>();
+    } else if (m_format == "in_transit"){
+        m_flush_format = std::make_unique<FlushFormatInTransit>(m_diag_name);
     } else if (m_format == "sensei"){
 #ifdef BL_USE_SENSEI_INSITU
         m_flush_format = std::make_unique<FlushFormatSensei>(
@@ -339,10 +350,18 @@ Diagnostics::FilterComputePackFlush (int step, bool force_flush)
 
     if ( DoComputeAndPack (step, force_flush) ) {
         ComputeAndPack();
+        AccumulateFieldBuffers();
 
         for (int i_buffer = 0; i_buffer < m_num_buffers; ++i_buffer) {
             if ( !DoDump (step, i_buffer, force_flush) ) continue;
-            Flush(i_buffer);
+            PrepareFieldBufferForFlush(i_buffer);
+            // Quantize the fields that request lossy compression, right before they are flushed
+            if (m_field_compression.IsActive()) {
+                for(int lev=0; lev<nlev_output; lev++){
+                    m_field_compression.Quantize(m_mf_output[i_buffer][lev], m_varnames);
+                }
+            }
+            Flush(i_buffer, force_flush);
         }
 
     }
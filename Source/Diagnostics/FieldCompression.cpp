@@ -0,0 +1,155 @@
+#include "FieldCompression.H"
+
+#include "Utils/WarpXProfilerWrapper.H"
+#include "Utils/WarpXUtil.H"
+
+#include <AMReX.H>
+#include <AMReX_Array4.H>
+#include <AMReX_BLassert.H>
+#include <AMReX_Box.H>
+#include <AMReX_Config.H>
+#include <AMReX_GpuContainers.H>
+#include <AMReX_GpuControl.H>
+#include <AMReX_GpuLaunch.H>
+#include <AMReX_GpuQualifiers.H>
+#include <AMReX_MFIter.H>
+#include <AMReX_MultiFab.H>
+#include <AMReX_ParmParse.H>
+
+#include <cmath>
+#include <set>
+#include <string>
+
+using namespace amrex::literals;
+
+namespace
+{
+    /** Read the compression settings found in a ParmParse prefix
+     * \param[in] pp ParmParse, either <diag_name>.compression or <diag_name>.compression.<field>
+     * \param[in,out] settings settings, only overwritten by the parameters found in pp
+     */
+    void
+    ReadSettings (const amrex::ParmParse& pp, FieldCompression::Settings& settings)
+    {
+        std::string type_str;
+        if (pp.query("type", type_str)) {
+            if      (type_str == "none")     settings.type = FieldCompression::Type::None;
+            else if (type_str == "lossless") settings.type = FieldCompression::Type::Lossless;
+            else if (type_str == "quantize") settings.type = FieldCompression::Type::Quantize;
+            else amrex::Abort("Unknown compression type " + type_str + " in " + pp.getPrefix()
+                              + ". Must be none, lossless or quantize.");
+        }
+        queryWithParser(pp, "tolerance", settings.tolerance);
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
+            settings.type != FieldCompression::Type::Quantize || settings.tolerance > 0._rt,
+            pp.getPrefix() + ".tolerance must be positive for compression type quantize");
+    }
+}
+
+FieldCompression::FieldCompression (const std::string& diag_name)
+{
+    const std::string prefix = diag_name + ".compression";
+    amrex::ParmParse pp_compression(prefix);
+    ReadSettings(pp_compression, m_default);
+    pp_compression.query("codec", m_codec);
+    pp_compression.query("level", m_level);
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(m_codec == "lz4" || m_codec == "zstd",
+                                     prefix + ".codec must be lz4 or zstd");
+
+    // Collect the fields that have their own settings, <prefix>.<field>.<key>
+    std::set<std::string> fields;
+    amrex::ParmParse pp;
+    for (auto const& entry : pp.getEntries(prefix)) {
+        const std::string key = entry.substr(prefix.size() + 1);
+        const auto dot = key.find_last_of('.');
+        if (dot != std::string::npos) fields.insert(key.substr(0, dot));
+    }
+    for (auto const& field : fields) {
+        Settings settings = m_default;
+        ReadSettings(amrex::ParmParse(prefix + "." + field), settings);
+        m_per_field[field] = settings;
+    }
+
+    m_active = (m_default.type != Type::None);
+    for (auto const& kv : m_per_field) {
+        if (kv.second.type != Type::None) m_active = true;
+    }
+}
+
+FieldCompression::Settings const&
+FieldCompression::GetSettings (const std::string& varname) const
+{
+    auto const it = m_per_field.find(varname);
+    if (it != m_per_field.end()) return it->second;
+    return m_default;
+}
+
+void
+FieldCompression::Quantize (amrex::MultiFab& mf, const amrex::Vector<std::string>& varnames) const
+{
+    WARPX_PROFILE("FieldCompression::Quantize()");
+
+    // Only the first varnames.size() components of mf are named output fields
+    const int ncomp = static_cast<int>(varnames.size());
+    AMREX_ALWAYS_ASSERT(mf.nComp() >= ncomp);
+    // Quantum of each component, 0 for components that are not quantized.
+    // The largest power of two not exceeding twice the tolerance is used, so that the
+    // rounding error is below the tolerance and the low mantissa bits are zero.
+    amrex::Gpu::DeviceVector<amrex::Real> quantum(ncomp);
+    amrex::Vector<amrex::Real> h_quantum(ncomp, 0._rt);
+    bool any_quantized = false;
+    for (int comp = 0; comp < ncomp; ++comp) {
+        Settings const& settings = GetSettings(varnames[comp]);
+        if (settings.type == Type::Quantize) {
+            h_quantum[comp] = std::exp2(std::floor(std::log2(2._rt*settings.tolerance)));
+            any_quantized = true;
+        }
+    }
+    if (!any_quantized) return;
+    amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice, h_quantum.begin(), h_quantum.end(),
+                          quantum.begin());
+    amrex::Real const * const AMREX_RESTRICT q_ptr = quantum.dataPtr();
+
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+    for (amrex::MFIter mfi(mf, amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const amrex::Box& bx = mfi.tilebox();
+        amrex::Array4<amrex::Real> const& arr = mf.array(mfi);
+        amrex::ParallelFor(bx, ncomp,
+            [=] AMREX_GPU_DEVICE (int i, int j, int k, int n)
+            {
+                const amrex::Real q = q_ptr[n];
+                if (q > 0._rt) arr(i,j,k,n) = q * std::round(arr(i,j,k,n) / q);
+            });
+    }
+    amrex::Gpu::synchronize();
+}
+
+std::string
+FieldCompression::OpenPMDDatasetOptions (const std::string& varname) const
+{
+    if (GetSettings(varname).type == Type::None) return "{}";
+
+    // Byte-shuffling followed by a fast lossless codec, through the ADIOS2 blosc operator.
+    // Quantized fields have zero low mantissa bits and compress well with this operator.
+    return R"END(
+{
+  "adios2": {
+    "dataset": {
+      "operators": [
+        {
+          "type": "blosc",
+          "parameters": {
+            "compressor": ")END" + m_codec + R"END(",
+            "clevel": ")END" + std::to_string(m_level) + R"END(",
+            "doshuffle": "BLOSC_SHUFFLE"
+          }
+        }
+      ]
+    }
+  }
+}
+)END";
+}
@@ -2,11 +2,18 @@
 
 #include "BoundaryConditions/PML.H"
 #include "Diagnostics/ParticleDiag/ParticleDiag.H"
+#include "FieldSolver/FiniteDifferenceSolver/MacroscopicProperties/MacroscopicProperties.H"
 #include "Particles/WarpXParticleContainer.H"
+#include "Utils/WarpXAlgorithmSelection.H"
 #include "Utils/WarpXProfilerWrapper.H"
 #include "WarpX.H"
 
+#include <AMReX.H>
+#include <AMReX_AsyncOut.H>
+#include <AMReX_BLassert.H>
+#include <AMReX_FileSystem.H>
 #include <AMReX_MultiFab.H>
+#include <AMReX_ParallelDescriptor.H>
 #include <AMReX_ParticleIO.H>
 #include <AMReX_PlotFileUtil.H>
 #include <AMReX_Print.H>
@@ -14,11 +21,124 @@
 #include <AMReX_Utility.H>
 #include <AMReX_VisMF.H>
 
+#ifdef AMREX_USE_MPI
+#   include <mpi.h>
+#endif
+#ifndef _WIN32
+#   include <dirent.h>
+#   include <sys/stat.h>
+#endif
+
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
 using namespace amrex;
 
 namespace
 {
     const std::string default_level_prefix {"Level_"};
+
+    /** Recursively copy directory src to dst. Does not use MPI, so it can run
+     *  in a helper thread.
+     * \return whether all files were copied successfully
+     */
+    bool
+    CopyDirectory (const std::string& src, const std::string& dst)
+    {
+#ifdef _WIN32
+        amrex::ignore_unused(src, dst);
+        return false;
+#else
+        if (!amrex::UtilCreateDirectory(dst, 0755)) return false;
+        DIR* dir = opendir(src.c_str());
+        if (dir == nullptr) return false;
+        bool success = true;
+        while (struct dirent* entry = readdir(dir)) {
+            const std::string name = entry->d_name;
+            if (name == "." || name == "..") continue;
+            const std::string src_path = src + "/" + name;
+            const std::string dst_path = dst + "/" + name;
+            struct stat st;
+            if (stat(src_path.c_str(), &st) != 0) {
+                success = false;
+            } else if (S_ISDIR(st.st_mode)) {
+                success = CopyDirectory(src_path, dst_path) && success;
+            } else {
+                std::ifstream ifs(src_path, std::ios::binary);
+                std::ofstream ofs(dst_path, std::ios::binary | std::ios::trunc);
+                if (st.st_size > 0) ofs << ifs.rdbuf();
+                ofs.close();
+                success = success && ifs.good() && ofs.good();
+            }
+        }
+        closedir(dir);
+        return success;
+#endif
+    }
+}
+
+FlushFormatCheckpoint::FlushFormatCheckpoint (const std::string& diag_name)
+    : FlushFormatPlotfile(diag_name)
+{
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(!m_single_precision,
+        diag_name + ".precision = single is not supported for checkpoints");
+
+    ParmParse pp_diag_name(diag_name);
+    pp_diag_name.query("local_dir", m_local_dir);
+    if (m_local_dir.empty()) return;
+
+#ifdef _WIN32
+    amrex::Abort(diag_name + ".local_dir is not supported on Windows");
+#endif
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(!m_async_flush,
+        diag_name + ".local_dir cannot be used with " + diag_name + ".async_flush = 1");
+    // With amrex.async_out, the PML fields and the particles are written by the AMReX
+    // I/O thread: the checkpoint could be marked complete and copied before it is written
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(!amrex::AsyncOut::UseAsyncOut(),
+        diag_name + ".local_dir cannot be used with amrex.async_out = 1");
+
+    // The first rank of each node (ranks that share memory) copies the node-local directory
+#ifdef AMREX_USE_MPI
+    MPI_Comm node_comm;
+    BL_MPI_REQUIRE( MPI_Comm_split_type(ParallelDescriptor::Communicator(), MPI_COMM_TYPE_SHARED,
+                                        ParallelDescriptor::MyProc(), MPI_INFO_NULL, &node_comm) );
+    int node_rank = 0;
+    BL_MPI_REQUIRE( MPI_Comm_rank(node_comm, &node_rank) );
+    BL_MPI_REQUIRE( MPI_Comm_free(&node_comm) );
+    m_node_root = (node_rank == 0);
+#endif
+    m_nnodes = m_node_root ? 1 : 0;
+    ParallelDescriptor::ReduceIntSum(m_nnodes);
+
+    // A file written by ranks of different nodes would be split across node-local
+    // directories: each rank must write its own files.
+    if (m_nnodes > 1) {
+        int particle_nfiles = 1024;
+        ParmParse("particles").query("particles_nfiles", particle_nfiles);
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
+            VisMF::GetNOutFiles() >= ParallelDescriptor::NProcs() &&
+            particle_nfiles >= ParallelDescriptor::NProcs(),
+            diag_name + ".local_dir on several nodes requires warpx.field_io_nfiles and "
+            "warpx.particle_io_nfiles to be at least the number of MPI ranks");
+    }
+}
+
+FlushFormatCheckpoint::~FlushFormatCheckpoint ()
+{
+    JoinDrainThread();
+}
+
+void
+FlushFormatCheckpoint::JoinDrainThread () const
+{
+    if (!m_drain_thread.joinable()) return;
+    m_drain_thread.join();
+    if (!m_drain_error.empty()) {
+        amrex::Warning(m_drain_error);
+        m_drain_error.clear();
+    }
 }
 
 void
@@ -43,12 +163,23 @@ FlushFormatCheckpoint::WriteToFile (
     VisMF::Header::Version current_version = VisMF::GetHeaderVersion();
     VisMF::SetHeaderVersion(amrex::VisMF::Header::NoFabHeader_v1);
 
-    const std::string& checkpointname = amrex::Concatenate(prefix, iteration[0], file_min_digits);
+    // With a node-local directory, the checkpoint is written there first
+    // and copied to its final location in the background.
+    const bool use_local_dir = !m_local_dir.empty();
+    const std::string write_prefix = use_local_dir ?
+        m_local_dir + "/" + prefix.substr(prefix.find_last_of('/') + 1) : prefix;
+    const std::string& checkpointname = amrex::Concatenate(write_prefix, iteration[0], file_min_digits);
 
     amrex::Print() << "  Writing checkpoint " << checkpointname << "\n";
 
-    // const int nlevels = finestLevel()+1;
-    amrex::PreBuildDirectorHierarchy(checkpointname, default_level_prefix, nlev, true);
+    if (use_local_dir) {
+        // Wait until the previous checkpoint has been copied (see the end of this function)
+        JoinDrainThread();
+        CreateLocalDirectories(checkpointname, nlev, particle_diags);
+    } else {
+        // const int nlevels = finestLevel()+1;
+        amrex::PreBuildDirectorHierarchy(checkpointname, default_level_prefix, nlev, true);
+    }
 
     WriteWarpXHeader(checkpointname, particle_diags, geom);
 
@@ -56,50 +187,78 @@ FlushFormatCheckpoint::WriteToFile (
 
     for (int lev = 0; lev < nlev; ++lev)
     {
-        VisMF::Write(warpx.getEfield_fp(lev, 0),
-                     amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Ex_fp"));
-        VisMF::Write(warpx.getEfield_fp(lev, 1),
-                     amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Ey_fp"));
-        VisMF::Write(warpx.getEfield_fp(lev, 2),
-                     amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Ez_fp"));
-        VisMF::Write(warpx.getBfield_fp(lev, 0),
-                     amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Bx_fp"));
-        VisMF::Write(warpx.getBfield_fp(lev, 1),
-                     amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "By_fp"));
-        VisMF::Write(warpx.getBfield_fp(lev, 2),
-                     amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Bz_fp"));
+        WriteMultiFab(warpx.getEfield_fp(lev, 0),
+                      amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Ex_fp"));
+        WriteMultiFab(warpx.getEfield_fp(lev, 1),
+                      amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Ey_fp"));
+        WriteMultiFab(warpx.getEfield_fp(lev, 2),
+                      amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Ez_fp"));
+        WriteMultiFab(warpx.getBfield_fp(lev, 0),
+                      amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Bx_fp"));
+        WriteMultiFab(warpx.getBfield_fp(lev, 1),
+                      amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "By_fp"));
+        WriteMultiFab(warpx.getBfield_fp(lev, 2),
+                      amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Bz_fp"));
+#ifdef WARPX_MAG_LLG
+        WriteMultiFab(warpx.getHfield_fp(lev, 0),
+                      amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Hx_fp"));
+        WriteMultiFab(warpx.getHfield_fp(lev, 1),
+                      amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Hy_fp"));
+        WriteMultiFab(warpx.getHfield_fp(lev, 2),
+                      amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Hz_fp"));
+        WriteMultiFab(warpx.getMfield_fp(lev, 0),
+                      amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Mx_fp"));
+        WriteMultiFab(warpx.getMfield_fp(lev, 1),
+                      amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "My_fp"));
+        WriteMultiFab(warpx.getMfield_fp(lev, 2),
+                      amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Mz_fp"));
+#endif
         if (warpx.getis_synchronized()) {
             // Need to save j if synchronized because after restart we need j to evolve E by dt/2.
-            VisMF::Write(warpx.getcurrent_fp(lev, 0),
-                         amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "jx_fp"));
-            VisMF::Write(warpx.getcurrent_fp(lev, 1),
-                         amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "jy_fp"));
-            VisMF::Write(warpx.getcurrent_fp(lev, 2),
-                         amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "jz_fp"));
+            WriteMultiFab(warpx.getcurrent_fp(lev, 0),
+                          amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "jx_fp"));
+            WriteMultiFab(warpx.getcurrent_fp(lev, 1),
+                          amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "jy_fp"));
+            WriteMultiFab(warpx.getcurrent_fp(lev, 2),
+                          amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "jz_fp"));
         }
 
         if (lev > 0)
         {
-            VisMF::Write(warpx.getEfield_cp(lev, 0),
-                         amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Ex_cp"));
-            VisMF::Write(warpx.getEfield_cp(lev, 1),
-                         amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Ey_cp"));
-            VisMF::Write(warpx.getEfield_cp(lev, 2),
-                         amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Ez_cp"));
-            VisMF::Write(warpx.getBfield_cp(lev, 0),
-                         amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Bx_cp"));
-            VisMF::Write(warpx.getBfield_cp(lev, 1),
-                         amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "By_cp"));
-            VisMF::Write(warpx.getBfield_cp(lev, 2),
-                         amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Bz_cp"));
+            WriteMultiFab(warpx.getEfield_cp(lev, 0),
+                          amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Ex_cp"));
+            WriteMultiFab(warpx.getEfield_cp(lev, 1),
+                          amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Ey_cp"));
+            WriteMultiFab(warpx.getEfield_cp(lev, 2),
+                          amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Ez_cp"));
+            WriteMultiFab(warpx.getBfield_cp(lev, 0),
+                          amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Bx_cp"));
+            WriteMultiFab(warpx.getBfield_cp(lev, 1),
+                          amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "By_cp"));
+            WriteMultiFab(warpx.getBfield_cp(lev, 2),
+                          amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Bz_cp"));
+#ifdef WARPX_MAG_LLG
+            WriteMultiFab(warpx.getHfield_cp(lev, 0),
+                          amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Hx_cp"));
+            WriteMultiFab(warpx.getHfield_cp(lev, 1),
+                          amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Hy_cp"));
+            WriteMultiFab(warpx.getHfield_cp(lev, 2),
+                          amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Hz_cp"));
+            WriteMultiFab(warpx.getMfield_cp(lev, 0),
+                          amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Mx_cp"));
+            WriteMultiFab(warpx.getMfield_cp(lev, 1),
+                          amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "My_cp"));
+            WriteMultiFab(warpx.getMfield_cp(lev, 2),
+                          amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "Mz_cp"));
+#endif
             if (warpx.getis_synchronized()) {
                 // Need to save j if synchronized because after restart we need j to evolve E by dt/2.
-                VisMF::Write(warpx.getcurrent_cp(lev, 0),
-                             amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "jx_cp"));
-                VisMF::Write(warpx.getcurrent_cp(lev, 1),
-                             amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "jy_cp"));
-                VisMF::Write(warpx.getcurrent_cp(lev, 2),
-                             amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "jz_cp"));
+                WriteMultiFab(warpx.getcurrent_cp(lev, 0),
+                              amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "jx_cp"));
+                WriteMultiFab(warpx.getcurrent_cp(lev, 1),
+                              amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "jy_cp"));
+                WriteMultiFab(warpx.getcurrent_cp(lev, 2),
+                              amrex::MultiFabFileFullPrefix(lev, checkpointname, default_level_prefix, "jz_cp"));
             }
         }
 
@@ -109,10 +268,174 @@ FlushFormatCheckpoint::WriteToFile (
         }
     }
 
+    // The time-invariant data is written at the first checkpoint of the run, in its own
+    // directory next to the checkpoints, and only referenced by the following checkpoints.
+    // With a moving window, it moves with the domain and is written in every checkpoint.
+    const bool write_static_dir = !WarpX::do_moving_window && m_static_dir.empty();
+    if (WarpX::do_moving_window) {
+        WriteStaticData(checkpointname, nlev);
+    } else if (write_static_dir) {
+        m_static_dir = amrex::Concatenate(write_prefix + "_static", iteration[0], file_min_digits);
+        if (use_local_dir) {
+            CreateLocalDirectories(m_static_dir, nlev, amrex::Vector<ParticleDiag>());
+        } else {
+            amrex::PreBuildDirectorHierarchy(m_static_dir, default_level_prefix, nlev, true);
+        }
+        WriteStaticData(m_static_dir, nlev);
+    }
+    if (ParallelDescriptor::IOProcessor()) {
+        // Path of the directory with the time-invariant data, relative to the checkpoint
+        std::string static_path = ".";
+        if (!WarpX::do_moving_window) {
+            static_path = "../" + m_static_dir.substr(m_static_dir.find_last_of('/') + 1);
+        }
+        std::ofstream static_file(checkpointname + "/StaticData");
+        static_file << static_path << "\n";
+        static_file.close();
+        if (!static_file.good()) amrex::FileOpenFailed(checkpointname + "/StaticData");
+    }
+
     CheckpointParticles(checkpointname, particle_diags);
 
     VisMF::SetHeaderVersion(current_version);
 
+    if (use_local_dir) {
+        // All ranks must be done writing before the copy starts
+        ParallelDescriptor::Barrier();
+
+        const std::string final_name = amrex::Concatenate(prefix, iteration[0], file_min_digits);
+        amrex::Print() << "  Copying checkpoint " << checkpointname << " to " << final_name
+                       << " in the background\n";
+
+        // On a single node, the local copy is a complete checkpoint that can be used for restart
+        if (m_nnodes == 1 && ParallelDescriptor::IOProcessor()) {
+            std::ofstream marker(checkpointname + "/LocalComplete");
+            marker << final_name << "\n";
+        }
+
+        if (m_node_root) {
+            std::vector<std::pair<std::string, std::string>> copies;
+            copies.emplace_back(checkpointname, final_name);
+            if (write_static_dir) {
+                copies.emplace_back(m_static_dir,
+                    amrex::Concatenate(prefix + "_static", iteration[0], file_min_digits));
+            }
+            // Bound the node-local storage to two checkpoints: once this checkpoint is copied,
+            // the previous one is removed. On a single node, this checkpoint is kept for restart
+            // until the next one is copied; on several nodes, each node only has part of it,
+            // so it is removed as soon as it is copied.
+            const std::string to_remove = (m_nnodes == 1) ? m_last_local_checkpoint : checkpointname;
+            m_drain_thread = std::thread([this, copies, to_remove] () {
+                for (auto const& copy : copies) {
+                    if (!CopyDirectory(copy.first, copy.second)) {
+                        m_drain_error = "failed to copy checkpoint " + copy.first + " to " + copy.second
+                                        + ": keeping the node-local copy";
+                        return;
+                    }
+                }
+                if (!to_remove.empty() && !amrex::FileSystem::RemoveAll(to_remove)) {
+                    m_drain_error = "failed to remove node-local checkpoint " + to_remove;
+                }
+            });
+        }
+        m_last_local_checkpoint = checkpointname;
+    }
+}
+
+void
+FlushFormatCheckpoint::CreateLocalDirectories (
+    const std::string& dir, int nlev,
+    const amrex::Vector<ParticleDiag>& particle_diags) const
+{
+    // Every node has its own node-local storage, so the directories
+    // are created by one rank per node instead of the I/O processor only.
+    if (m_node_root) {
+        amrex::Vector<std::string> dirs {dir};
+        for (int lev = 0; lev < nlev; ++lev) {
+            dirs.push_back(dir + "/" + amrex::LevelPath(lev, default_level_prefix));
+        }
+        for (auto const& part_diag : particle_diags) {
+            const std::string species_dir = dir + "/" + part_diag.getSpeciesName();
+            dirs.push_back(species_dir);
+            for (int lev = 0; lev < nlev; ++lev) {
+                dirs.push_back(species_dir + "/" + amrex::LevelPath(lev, default_level_prefix));
+            }
+        }
+        for (auto const& d : dirs) {
+            if (!amrex::UtilCreateDirectory(d, 0755)) amrex::CreateDirectoryFailed(d);
+        }
+    }
+    ParallelDescriptor::Barrier();
+}
+
+void
+FlushFormatCheckpoint::WriteMultiFab (const amrex::MultiFab& mf, const std::string& name) const
+{
+    if (m_async_flush) {
+        // The data is copied to a staging buffer before returning,
+        // and written to file by the AMReX I/O thread.
+        VisMF::AsyncWrite(mf, name);
+    } else {
+        VisMF::Write(mf, name);
+    }
+}
+
+void
+FlushFormatCheckpoint::WriteStaticData (const std::string& dir, int nlev) const
+{
+    WARPX_PROFILE("FlushFormatCheckpoint::WriteStaticData()");
+
+    auto & warpx = WarpX::GetInstance();
+
+#ifdef WARPX_MAG_LLG
+    for (int lev = 0; lev < nlev; ++lev) {
+        WriteMultiFab(warpx.getH_biasfield_fp(lev, 0),
+                      amrex::MultiFabFileFullPrefix(lev, dir, default_level_prefix, "H_biasx_fp"));
+        WriteMultiFab(warpx.getH_biasfield_fp(lev, 1),
+                      amrex::MultiFabFileFullPrefix(lev, dir, default_level_prefix, "H_biasy_fp"));
+        WriteMultiFab(warpx.getH_biasfield_fp(lev, 2),
+                      amrex::MultiFabFileFullPrefix(lev, dir, default_level_prefix, "H_biasz_fp"));
+        if (lev > 0) {
+            WriteMultiFab(warpx.getH_biasfield(lev, 0),
+                          amrex::MultiFabFileFullPrefix(lev, dir, default_level_prefix, "H_biasx_aux"));
+            WriteMultiFab(warpx.getH_biasfield(lev, 1),
+                          amrex::MultiFabFileFullPrefix(lev, dir, default_level_prefix, "H_biasy_aux"));
+            WriteMultiFab(warpx.getH_biasfield(lev, 2),
+                          amrex::MultiFabFileFullPrefix(lev, dir, default_level_prefix, "H_biasz_aux"));
+            WriteMultiFab(warpx.getH_biasfield_cp(lev, 0),
+                          amrex::MultiFabFileFullPrefix(lev, dir, default_level_prefix, "H_biasx_cp"));
+            WriteMultiFab(warpx.getH_biasfield_cp(lev, 1),
+                          amrex::MultiFabFileFullPrefix(lev, dir, default_level_prefix, "H_biasy_cp"));
+            WriteMultiFab(warpx.getH_biasfield_cp(lev, 2),
+                          amrex::MultiFabFileFullPrefix(lev, dir, default_level_prefix, "H_biasz_cp"));
+        }
+    }
+#else
+    amrex::ignore_unused(nlev);
+#endif
+
+    // The material properties are only defined on level 0
+    if (WarpX::em_solver_medium == MediumForEM::Macroscopic) {
+        auto & macro = warpx.GetMacroscopicProperties();
+        WriteMultiFab(macro.getsigma_mf(),
+                      amrex::MultiFabFileFullPrefix(0, dir, default_level_prefix, "sigma"));
+        WriteMultiFab(macro.getepsilon_mf(),
+                      amrex::MultiFabFileFullPrefix(0, dir, default_level_prefix, "epsilon"));
+        WriteMultiFab(macro.getmu_mf(),
+                      amrex::MultiFabFileFullPrefix(0, dir, default_level_prefix, "mu"));
+#ifdef WARPX_MAG_LLG
+        WriteMultiFab(macro.getmag_Ms_mf(),
+                      amrex::MultiFabFileFullPrefix(0, dir, default_level_prefix, "mag_Ms"));
+        WriteMultiFab(macro.getmag_alpha_mf(),
+                      amrex::MultiFabFileFullPrefix(0, dir, default_level_prefix, "mag_alpha"));
+        WriteMultiFab(macro.getmag_gamma_mf(),
+                      amrex::MultiFabFileFullPrefix(0, dir, default_level_prefix, "mag_gamma"));
+        WriteMultiFab(macro.getmag_exchange_mf(),
+                      amrex::MultiFabFileFullPrefix(0, dir, default_level_prefix, "mag_exchange"));
+        WriteMultiFab(macro.getmag_anisotropy_mf(),
+                      amrex::MultiFabFileFullPrefix(0, dir, default_level_prefix, "mag_anisotropy"));
+#endif
+    }
 }
 
 void
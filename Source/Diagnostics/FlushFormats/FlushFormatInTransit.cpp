@@ -0,0 +1,330 @@
+#include "FlushFormatInTransit.H"
+
+#include "Diagnostics/ParticleDiag/ParticleDiag.H"
+#include "Particles/Filter/FilterCompactParticles.H"
+#include "Particles/Filter/FilterFunctors.H"
+#include "Particles/WarpXParticleContainer.H"
+#include "Utils/WarpXProfilerWrapper.H"
+#include "Utils/WarpXUtil.H"
+#include "WarpX.H"
+
+#include <AMReX.H>
+#include <AMReX_Array4.H>
+#include <AMReX_BLassert.H>
+#include <AMReX_Box.H>
+#include <AMReX_FArrayBox.H>
+#include <AMReX_GpuAllocators.H>
+#include <AMReX_GpuDevice.H>
+#include <AMReX_Loop.H>
+#include <AMReX_MFIter.H>
+#include <AMReX_MultiFab.H>
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_ParmParse.H>
+#include <AMReX_REAL.H>
+
+#ifndef _WIN32
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace amrex;
+
+namespace
+{
+    /** Layout version of the ring buffer, see Tools/PostProcessing/read_in_transit.py */
+    constexpr std::uint64_t buffer_version = 1;
+    /** Size of the header of the ring buffer: magic, version, nslots, slot_size, head, replaced */
+    constexpr std::size_t buffer_header_size = 6 * sizeof(std::uint64_t);
+    /** Size of the header of a slot: sequence number, message size, text header size */
+    constexpr std::size_t slot_header_size = 3 * sizeof(std::uint64_t);
+
+    /** Round n up to a multiple of 8 bytes, so that all arrays are aligned */
+    constexpr std::size_t Align (std::size_t n) { return (n + 7) / 8 * 8; }
+
+    using PinnedParticleContainer =
+        amrex::AmrParticleContainer<0, 0, PIdx::nattribs, 0, amrex::PinnedArenaAllocator>;
+    using PinnedParIter = amrex::ParIter<0, 0, PIdx::nattribs, 0, amrex::PinnedArenaAllocator>;
+
+    /** Store a 64-bit word of the ring buffer, visible to readers after all previous stores */
+    void
+    Publish (char* p, std::uint64_t value)
+    {
+        std::atomic_thread_fence(std::memory_order_release);
+        *reinterpret_cast<volatile std::uint64_t*>(p) = value;
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+}
+
+FlushFormatInTransit::FlushFormatInTransit (const std::string& diag_name)
+{
+#ifdef _WIN32
+    amrex::Abort(diag_name + ".format = in_transit is not supported on Windows");
+#endif
+    ParmParse pp_diag_name(diag_name);
+    std::string dir = "/dev/shm";
+    pp_diag_name.query("in_transit.dir", dir);
+    queryWithParser(pp_diag_name, "in_transit.slots", m_nslots);
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(m_nslots >= 1,
+        diag_name + ".in_transit.slots must be at least 1");
+    m_path = dir + "/warpx_" + diag_name + "_" + std::to_string(ParallelDescriptor::MyProc());
+}
+
+FlushFormatInTransit::~FlushFormatInTransit ()
+{
+    UnmapBuffer(false);
+}
+
+void
+FlushFormatInTransit::UnmapBuffer (bool replaced) const
+{
+#ifndef _WIN32
+    if (m_buffer == nullptr) return;
+    // Readers that still map the old buffer re-open the file when they see this flag
+    if (replaced) Publish(m_buffer + 5 * sizeof(std::uint64_t), 1);
+    munmap(m_buffer, m_buffer_size);
+    unlink(m_path.c_str());
+    m_buffer = nullptr;
+    m_buffer_size = 0;
+    m_slot_size = 0;
+#else
+    amrex::ignore_unused(replaced);
+#endif
+}
+
+void
+FlushFormatInTransit::MapBuffer (std::size_t slot_size) const
+{
+#ifndef _WIN32
+    if (slot_size <= m_slot_size) return;
+    UnmapBuffer(true);
+
+    // Leave some room for the growth of the particle data, to avoid frequent re-allocations
+    constexpr std::size_t page_size = 4096;
+    m_slot_size = (slot_size + slot_size / 4 + page_size - 1) / page_size * page_size;
+    m_buffer_size = buffer_header_size + m_nslots * m_slot_size;
+
+    unlink(m_path.c_str());
+    const int fd = open(m_path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) amrex::Abort("FlushFormatInTransit: cannot create " + m_path);
+    if (ftruncate(fd, static_cast<off_t>(m_buffer_size)) != 0) {
+        amrex::Abort("FlushFormatInTransit: cannot allocate " + std::to_string(m_buffer_size)
+                     + " bytes for " + m_path);
+    }
+    void* p = mmap(nullptr, m_buffer_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) amrex::Abort("FlushFormatInTransit: cannot map " + m_path);
+    m_buffer = static_cast<char*>(p);
+
+    // The file is zero-initialized by ftruncate: all slots are empty
+    const std::uint64_t header[5] = {0, buffer_version, static_cast<std::uint64_t>(m_nslots),
+                                     static_cast<std::uint64_t>(m_slot_size), m_nmessages};
+    std::memcpy(m_buffer + sizeof(std::uint64_t), header + 1, 4 * sizeof(std::uint64_t));
+    // The magic number is written last: readers wait for it before reading the header
+    std::uint64_t magic;
+    std::memcpy(&magic, "WXINTRS1", sizeof(magic));
+    Publish(m_buffer, magic);
+#else
+    amrex::ignore_unused(slot_size);
+#endif
+}
+
+void
+FlushFormatInTransit::WriteToFile (
+    const amrex::Vector<std::string> varnames,
+    const amrex::Vector<amrex::MultiFab>& mf,
+    amrex::Vector<amrex::Geometry>& geom,
+    const amrex::Vector<int> iteration, const double time,
+    const amrex::Vector<ParticleDiag>& particle_diags, int nlev,
+    const std::string /*prefix*/, int /*file_min_digits*/, bool plot_raw_fields,
+    bool plot_raw_fields_guards, bool plot_raw_rho, bool plot_raw_F,
+    bool /*isBTD*/, int /*snapshotID*/, const amrex::Geometry& /*full_BTD_snapshot*/,
+    bool /*isLastBTDFlush*/) const
+{
+    WARPX_PROFILE("FlushFormatInTransit::WriteToFile()");
+
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
+        !plot_raw_fields && !plot_raw_fields_guards && !plot_raw_rho && !plot_raw_F,
+        "Cannot publish raw data with in_transit output format.");
+
+    // Copy the selected particles out of the device first, to know their number
+    amrex::Vector<std::unique_ptr<PinnedParticleContainer>> particles;
+    amrex::Vector<amrex::Vector<std::string>> particle_names;
+    for (auto const& particle_diag : particle_diags) {
+        WarpXParticleContainer* pc = particle_diag.getParticleContainer();
+        auto tmp = std::make_unique<PinnedParticleContainer>(&WarpX::GetInstance());
+        for (int ic = 0; ic < pc->NumRuntimeRealComps(); ++ic) { tmp->AddRealComp(false); }
+        for (int ic = 0; ic < pc->NumRuntimeIntComps(); ++ic) { tmp->AddIntComp(false); }
+        pc->ConvertUnits(ConvertDirection::WarpX_to_SI);
+        filterAndCompactParticles(*tmp, *pc, particle_diag.GetFilter());
+        pc->ConvertUnits(ConvertDirection::SI_to_WarpX);
+
+        amrex::Vector<std::string> names {"weight", "momentum_x", "momentum_y", "momentum_z"};
+#ifdef WARPX_DIM_RZ
+        names.push_back("theta");
+#endif
+        names.resize(pc->NumRealComps());
+        for (auto const& x : pc->getParticleRuntimeComps()) {
+            names[x.second+PIdx::nattribs] = x.first;
+        }
+        // Only the components requested in the diagnostics are published
+        amrex::Vector<int> flags = particle_diag.plot_flags;
+        flags.resize(pc->NumRealComps(), 1);
+        for (int ic = 0; ic < pc->NumRealComps(); ++ic) {
+            if (!flags[ic]) names[ic].clear();
+        }
+        particles.push_back(std::move(tmp));
+        particle_names.push_back(std::move(names));
+    }
+
+    // Text header of the message, with the offsets of all arrays in the data section
+    std::ostringstream header;
+    header << std::setprecision(17);
+    header << "WarpX-InTransit-V1\n";
+    header << "iteration " << iteration[0] << "\n";
+    header << "time " << time << "\n";
+    header << "rank " << ParallelDescriptor::MyProc() << "\n";
+    header << "real_size " << sizeof(Real) << " " << sizeof(ParticleReal) << "\n";
+    header << "nlevels " << nlev << "\n";
+    for (int lev = 0; lev < nlev; ++lev) {
+        const Box& domain = geom[lev].Domain();
+        header << "level " << lev;
+        for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) header << " " << domain.smallEnd(idim);
+        for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) header << " " << domain.bigEnd(idim);
+        for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) header << " " << geom[lev].ProbLo(idim);
+        for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) header << " " << geom[lev].ProbHi(idim);
+        header << "\n";
+    }
+    header << "fields " << varnames.size();
+    for (auto const& name : varnames) header << " " << name;
+    header << "\n";
+
+    std::size_t data_size = 0;
+    const int ncomp = static_cast<int>(varnames.size());
+    if (ncomp > 0) {
+        for (int lev = 0; lev < nlev; ++lev) {
+            for (MFIter mfi(mf[lev]); mfi.isValid(); ++mfi) {
+                const Box& bx = mfi.validbox();
+                header << "fab " << lev;
+                for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) header << " " << bx.smallEnd(idim);
+                for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) header << " " << bx.bigEnd(idim);
+                header << " " << data_size << "\n";
+                data_size += Align(bx.numPts() * ncomp * sizeof(Real));
+            }
+        }
+    }
+
+#if defined(WARPX_DIM_RZ)
+    const amrex::Vector<std::string> position_names {"r", "z"};
+#elif (AMREX_SPACEDIM == 2)
+    const amrex::Vector<std::string> position_names {"x", "z"};
+#else
+    const amrex::Vector<std::string> position_names {"x", "y", "z"};
+#endif
+    amrex::Vector<Long> np_species(particles.size());
+    for (int is = 0; is < particles.size(); ++is) {
+        np_species[is] = particles[is]->TotalNumberOfParticles(true, true);
+        header << "species " << particle_diags[is].getSpeciesName() << " " << np_species[is];
+        // positions, then requested real components, as contiguous ParticleReal arrays
+        for (auto const& name : position_names) {
+            header << " " << name << ":" << data_size;
+            data_size += Align(np_species[is] * sizeof(ParticleReal));
+        }
+        for (auto const& name : particle_names[is]) {
+            if (name.empty()) continue;
+            header << " " << name << ":" << data_size;
+            data_size += Align(np_species[is] * sizeof(ParticleReal));
+        }
+        // globally unique particle ids, as uint64
+        header << " id:" << data_size << "\n";
+        data_size += Align(np_species[is] * sizeof(std::uint64_t));
+    }
+    header << "end\n";
+
+    const std::string header_str = header.str();
+    const std::size_t header_size = Align(header_str.size());
+    MapBuffer(slot_header_size + header_size + data_size);
+
+    // Mark the slot as being written (odd sequence number), then fill it
+    char* const slot = m_buffer + buffer_header_size + (m_nmessages % m_nslots) * m_slot_size;
+    Publish(slot, 2*m_nmessages + 1);
+    const std::uint64_t sizes[2] = {static_cast<std::uint64_t>(header_size + data_size),
+                                    static_cast<std::uint64_t>(header_size)};
+    std::memcpy(slot + sizeof(std::uint64_t), sizes, sizeof(sizes));
+    std::memset(slot + slot_header_size, ' ', header_size);
+    std::memcpy(slot + slot_header_size, header_str.data(), header_str.size());
+    char* const data = slot + slot_header_size + header_size;
+
+    std::size_t offset = 0;
+    if (ncomp > 0) {
+        for (int lev = 0; lev < nlev; ++lev) {
+            for (MFIter mfi(mf[lev]); mfi.isValid(); ++mfi) {
+                const Box& bx = mfi.validbox();
+                Real* const dst = reinterpret_cast<Real*>(data + offset);
+#ifdef AMREX_USE_GPU
+                // The shared memory is not accessible from the device: stage in pinned memory
+                FArrayBox staging(bx, ncomp, The_Pinned_Arena());
+                staging.copy<RunOn::Device>(mf[lev][mfi], bx, 0, bx, 0, ncomp);
+                Gpu::streamSynchronize();
+                std::memcpy(dst, staging.dataPtr(), bx.numPts() * ncomp * sizeof(Real));
+#else
+                // Copy the valid box directly into the shared memory
+                Array4<Real const> const& src = mf[lev].const_array(mfi);
+                Array4<Real> const dst_arr(dst, amrex::begin(bx), amrex::end(bx), ncomp);
+                amrex::LoopOnCpu(bx, ncomp, [=] (int i, int j, int k, int n) noexcept
+                {
+                    dst_arr(i,j,k,n) = src(i,j,k,n);
+                });
+#endif
+                offset += Align(bx.numPts() * ncomp * sizeof(Real));
+            }
+        }
+    }
+
+    for (int is = 0; is < particles.size(); ++is) {
+        const int npos = static_cast<int>(position_names.size());
+        amrex::Vector<int> comps;
+        for (int ic = 0; ic < particle_names[is].size(); ++ic) {
+            if (!particle_names[is][ic].empty()) comps.push_back(ic);
+        }
+        const std::size_t array_size = Align(np_species[is] * sizeof(ParticleReal));
+        auto* const ids = reinterpret_cast<std::uint64_t*>(
+            data + offset + (npos + comps.size()) * array_size);
+
+        // The particles are in pinned host memory: copy them tile by tile
+        Long ip0 = 0;
+        for (int lev = 0; lev <= particles[is]->finestLevel(); ++lev) {
+            for (PinnedParIter pti(*particles[is], lev); pti.isValid(); ++pti) {
+                const auto& aos = pti.GetArrayOfStructs();
+                const auto& soa = pti.GetStructOfArrays();
+                const Long np = pti.numParticles();
+                for (int ipos = 0; ipos < npos; ++ipos) {
+                    auto* const dst = reinterpret_cast<ParticleReal*>(data + offset + ipos * array_size);
+                    for (Long ip = 0; ip < np; ++ip) dst[ip0 + ip] = aos[ip].pos(ipos);
+                }
+                for (int ic = 0; ic < comps.size(); ++ic) {
+                    auto* const dst = reinterpret_cast<ParticleReal*>(
+                        data + offset + (npos + ic) * array_size);
+                    std::memcpy(dst + ip0, soa.GetRealData(comps[ic]).dataPtr(), np * sizeof(ParticleReal));
+                }
+                for (Long ip = 0; ip < np; ++ip) {
+                    ids[ip0 + ip] = WarpXUtilIO::localIDtoGlobal(aos[ip].id(), aos[ip].cpu());
+                }
+                ip0 += np;
+            }
+        }
+        offset += (npos + comps.size()) * array_size + Align(np_species[is] * sizeof(std::uint64_t));
+    }
+
+    // The message is complete: publish it
+    Publish(slot, 2*m_nmessages + 2);
+    ++m_nmessages;
+    Publish(m_buffer + 4 * sizeof(std::uint64_t), m_nmessages);
+}
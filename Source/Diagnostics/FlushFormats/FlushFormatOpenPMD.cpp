@@ -1,5 +1,6 @@
 #include "FlushFormatOpenPMD.H"
 
+#include "Diagnostics/FieldCompression.H"
 #include "Utils/WarpXProfilerWrapper.H"
 #include "WarpX.H"
 
@@ -80,11 +81,26 @@ FlushFormatOpenPMD::FlushFormatOpenPMD (const std::string& diag_name)
     operator_parameters.insert({k, v});
   }
 
+  // Precision of the field output
+  std::string precision = "double";
+  pp_diag_name.query("precision", precision);
+  AMREX_ALWAYS_ASSERT_WITH_MESSAGE(precision == "single" || precision == "double",
+      diag_name + ".precision must be single or double");
+
+  // Number of particles per chunk when streaming particles (0: copy each species first)
+  int particle_chunk_size = 0;
+  pp_diag_name.query("openpmd_particle_chunk_size", particle_chunk_size);
+  AMREX_ALWAYS_ASSERT_WITH_MESSAGE(particle_chunk_size >= 0,
+      diag_name + ".openpmd_particle_chunk_size must be non-negative");
+
   auto & warpx = WarpX::GetInstance();
   m_OpenPMDPlotWriter = std::make_unique<WarpXOpenPMDPlot>(
     encoding, openpmd_backend,
     operator_type, operator_parameters,
-    warpx.getPMLdirections()
+    warpx.getPMLdirections(),
+    FieldCompression(diag_name),
+    precision == "single",
+    particle_chunk_size
   );
 }
 
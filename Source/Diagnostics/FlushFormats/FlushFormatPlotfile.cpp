@@ -1,7 +1,9 @@
 #include "FlushFormatPlotfile.H"
 
 #include "Diagnostics/ParticleDiag/ParticleDiag.H"
+#include "Particles/Filter/FilterCompactParticles.H"
 #include "Particles/Filter/FilterFunctors.H"
+#include "Particles/PinnedMemoryParticleContainer.H"
 #include "Particles/WarpXParticleContainer.H"
 #include "Utils/Interpolate.H"
 #include "Utils/WarpXProfilerWrapper.H"
@@ -9,12 +11,19 @@
 
 #include <AMReX.H>
 #include <AMReX_AmrParticles.H>
+#include <AMReX_Arena.H>
+#include <AMReX_AsyncOut.H>
+#include <AMReX_BLassert.H>
 #include <AMReX_Box.H>
 #include <AMReX_BoxArray.H>
 #include <AMReX_Config.H>
+#include <AMReX_FArrayBox.H>
 #include <AMReX_GpuAllocators.H>
+#include <AMReX_GpuDevice.H>
 #include <AMReX_GpuQualifiers.H>
+#include <AMReX_INT.H>
 #include <AMReX_IntVect.H>
+#include <AMReX_MFIter.H>
 #include <AMReX_MakeType.H>
 #include <AMReX_MultiFab.H>
 #include <AMReX_PODVector.H>
@@ -28,6 +37,7 @@
 #include <AMReX_Utility.H>
 #include <AMReX_VisMF.H>
 #include <AMReX_buildInfo.H>
+#include <AMReX_ccse-mpi.H>
 
 #ifdef AMREX_USE_OMP
 #   include <omp.h>
@@ -39,6 +49,8 @@
 #include <fstream>
 #include <map>
 #include <memory>
+#include <ostream>
+#include <streambuf>
 #include <utility>
 #include <vector>
 
@@ -47,6 +59,146 @@ using namespace amrex;
 namespace
 {
     const std::string default_level_prefix {"Level_"};
+
+    /** Output stream buffer that appends to a byte vector, so that the serialized
+     *  FABs are written to file or sent to the aggregator without another copy */
+    class AppendByteBuffer : public std::streambuf
+    {
+    public:
+        explicit AppendByteBuffer (amrex::Vector<char>& bytes) : m_bytes(bytes) {}
+
+    protected:
+        std::streamsize xsputn (const char* s, std::streamsize n) override
+        {
+            m_bytes.insert(m_bytes.end(), s, s + n);
+            return n;
+        }
+
+        int_type overflow (int_type c) override
+        {
+            if (!traits_type::eq_int_type(c, traits_type::eof())) {
+                m_bytes.push_back(traits_type::to_char_type(c));
+            }
+            return traits_type::not_eof(c);
+        }
+
+    private:
+        amrex::Vector<char>& m_bytes;
+    };
+
+    /** Write the top-level Header of a plotfile, on the I/O processor */
+    void WritePlotfileHeader (const std::string& filename, int nlev,
+                              const amrex::Vector<amrex::MultiFab>& mf,
+                              const amrex::Vector<std::string>& varnames,
+                              const amrex::Vector<amrex::Geometry>& geom,
+                              const double time, const amrex::Vector<int>& iteration)
+    {
+        if (!ParallelDescriptor::IOProcessor()) return;
+        auto & warpx = WarpX::GetInstance();
+
+        Vector<BoxArray> boxArrays(nlev);
+        for (int lev = 0; lev < nlev; ++lev) {
+            boxArrays[lev] = mf[lev].boxArray();
+        }
+
+        VisMF::IO_Buffer io_buffer(VisMF::IO_Buffer_Size);
+        std::ofstream HeaderFile;
+        HeaderFile.rdbuf()->pubsetbuf(io_buffer.dataPtr(), io_buffer.size());
+        std::string HeaderFileName(filename + "/Header");
+        HeaderFile.open(HeaderFileName.c_str(), std::ofstream::out   |
+                                                std::ofstream::trunc |
+                                                std::ofstream::binary);
+        if( ! HeaderFile.good())
+            amrex::FileOpenFailed(HeaderFileName);
+
+        amrex::WriteGenericPlotfileHeader(HeaderFile, nlev, boxArrays, varnames, geom,
+                                          static_cast<Real>(time), iteration, warpx.refRatio(),
+                                          "HyperCLaw-V1.1", default_level_prefix, "Cell");
+    }
+
+#ifdef AMREX_USE_MPI
+    /** Send or receive a buffer of any size, in messages of at most 1 GiB */
+    constexpr Long max_message_size = Long(1) << 30;
+
+    void SendBytes (const char* data, Long size, int dest, MPI_Comm comm)
+    {
+        for (Long offset = 0; offset < size; offset += max_message_size) {
+            const int count = static_cast<int>(std::min(max_message_size, size - offset));
+            MPI_Send(data + offset, count, MPI_CHAR, dest, 0, comm);
+        }
+    }
+
+    void RecvBytes (char* data, Long size, int source, MPI_Comm comm)
+    {
+        for (Long offset = 0; offset < size; offset += max_message_size) {
+            const int count = static_cast<int>(std::min(max_message_size, size - offset));
+            MPI_Recv(data + offset, count, MPI_CHAR, source, 0, comm, MPI_STATUS_IGNORE);
+        }
+    }
+#endif
+}
+
+FlushFormatPlotfile::FlushFormatPlotfile (const std::string& diag_name)
+{
+    ParmParse pp_diag_name(diag_name);
+    pp_diag_name.query("async_flush", m_async_flush);
+
+    std::string precision = "double";
+    pp_diag_name.query("precision", precision);
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(precision == "single" || precision == "double",
+        diag_name + ".precision must be single or double");
+    m_single_precision = (precision == "single");
+
+    std::string diag_type_str;
+    pp_diag_name.query("diag_type", diag_type_str);
+    if (diag_type_str == "BackTransformed") {
+        // With async_flush, BTDiagnostics appends the buffers to the snapshots itself and
+        // does not call WriteToFile. Otherwise, the buffers are merged into the snapshot
+        // right after being flushed, so they have to be on disk when WriteToFile returns.
+        m_async_flush = false;
+    }
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
+        !m_async_flush || amrex::AsyncOut::UseAsyncOut(),
+        diag_name + ".async_flush = 1 requires amrex.async_out = 1");
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
+        !(m_async_flush && m_single_precision),
+        diag_name + ".async_flush = 1 is not supported with " + diag_name + ".precision = single");
+
+    pp_diag_name.query("aggregate_io", m_aggregate_io);
+    // BTD buffers are merged into the snapshots with the default layout
+    if (diag_type_str == "BackTransformed") m_aggregate_io = false;
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
+        !(m_aggregate_io && m_async_flush),
+        diag_name + ".aggregate_io = 1 is not supported with " + diag_name + ".async_flush = 1");
+    if (!m_aggregate_io) return;
+
+    pp_diag_name.query("aggregate_io_alignment", m_aggregate_io_alignment);
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(m_aggregate_io_alignment > 0,
+        diag_name + ".aggregate_io_alignment must be positive");
+    int ranks_per_file = 0;
+    pp_diag_name.query("aggregate_io_ranks_per_file", ranks_per_file);
+#ifdef AMREX_USE_MPI
+    // Group the ranks by node, then split the nodes into groups of ranks_per_file ranks
+    MPI_Comm node_comm;
+    MPI_Comm_split_type(ParallelDescriptor::Communicator(), MPI_COMM_TYPE_SHARED,
+                        ParallelDescriptor::MyProc(), MPI_INFO_NULL, &node_comm);
+    int node_rank = 0;
+    MPI_Comm_rank(node_comm, &node_rank);
+    const int color = (ranks_per_file > 0) ? node_rank / ranks_per_file : 0;
+    MPI_Comm_split(node_comm, color, node_rank, &m_aggregation_comm);
+    MPI_Comm_free(&node_comm);
+#else
+    amrex::ignore_unused(ranks_per_file);
+#endif
+}
+
+FlushFormatPlotfile::~FlushFormatPlotfile ()
+{
+#ifdef AMREX_USE_MPI
+    int finalized = 0;
+    MPI_Finalized(&finalized);
+    if (m_aggregation_comm != MPI_COMM_NULL && !finalized) MPI_Comm_free(&m_aggregation_comm);
+#endif
 }
 
 void
@@ -69,16 +221,26 @@ FlushFormatPlotfile::WriteToFile (
     Vector<std::string> rfs;
     VisMF::Header::Version current_version = VisMF::GetHeaderVersion();
     VisMF::SetHeaderVersion(amrex::VisMF::Header::Version_v1);
+    // VisMF converts the field data to the real descriptor of the FAB format when writing,
+    // so that single precision output does not need an additional copy of the data.
+    FABio::Format const current_format = FArrayBox::getFormat();
+    if (m_single_precision) FArrayBox::setFormat(FABio::FAB_NATIVE_32);
     if (plot_raw_fields) rfs.emplace_back("raw_fields");
-    amrex::WriteMultiLevelPlotfile(filename, nlev,
-                                   amrex::GetVecOfConstPtrs(mf),
-                                   varnames, geom,
-                                   static_cast<Real>(time), iteration, warpx.refRatio(),
-                                   "HyperCLaw-V1.1",
-                                   "Level_",
-                                   "Cell",
-                                   rfs
-                                   );
+    if (m_async_flush) {
+        WriteFieldsAsync(filename, nlev, mf, varnames, geom, time, iteration, rfs);
+    } else if (m_aggregate_io) {
+        WriteFieldsAggregated(filename, nlev, mf, varnames, geom, time, iteration, rfs);
+    } else {
+        amrex::WriteMultiLevelPlotfile(filename, nlev,
+                                       amrex::GetVecOfConstPtrs(mf),
+                                       varnames, geom,
+                                       static_cast<Real>(time), iteration, warpx.refRatio(),
+                                       "HyperCLaw-V1.1",
+                                       "Level_",
+                                       "Cell",
+                                       rfs
+                                       );
+    }
 
     WriteAllRawFields(plot_raw_fields, nlev, filename, plot_raw_fields_guards,
                       plot_raw_rho, plot_raw_F);
@@ -89,9 +251,164 @@ FlushFormatPlotfile::WriteToFile (
 
     WriteWarpXHeader(filename, particle_diags, geom);
 
+    FArrayBox::setFormat(current_format);
     VisMF::SetHeaderVersion(current_version);
 }
 
+void
+FlushFormatPlotfile::WriteFieldsAsync (
+    const std::string& filename, int nlev,
+    const amrex::Vector<amrex::MultiFab>& mf,
+    const amrex::Vector<std::string>& varnames,
+    const amrex::Vector<amrex::Geometry>& geom,
+    const double time, const amrex::Vector<int>& iteration,
+    const amrex::Vector<std::string>& extra_dirs) const
+{
+    WARPX_PROFILE("FlushFormatPlotfile::WriteFieldsAsync()");
+
+    // The directories are created synchronously: particles, raw fields and
+    // headers are written into them by the main thread right after this call.
+    amrex::PreBuildDirectorHierarchy(filename, default_level_prefix, nlev, true);
+    for (auto const& extra_dir : extra_dirs) {
+        amrex::PreBuildDirectorHierarchy(filename + "/" + extra_dir, default_level_prefix, nlev, true);
+    }
+    ParallelDescriptor::Barrier();
+
+    WritePlotfileHeader(filename, nlev, mf, varnames, geom, time, iteration);
+
+    for (int lev = 0; lev < nlev; ++lev) {
+        // Stage the valid cells in pinned host memory. The staging buffer is moved
+        // to the I/O thread, which owns it until the data is on disk.
+        MultiFab staging(mf[lev].boxArray(), mf[lev].DistributionMap(), mf[lev].nComp(), 0,
+                         MFInfo().SetArena(The_Pinned_Arena()));
+        MultiFab::Copy(staging, mf[lev], 0, 0, mf[lev].nComp(), 0);
+        VisMF::AsyncWrite(std::move(staging),
+                          amrex::MultiFabFileFullPrefix(lev, filename, default_level_prefix, "Cell"),
+                          true);
+    }
+}
+
+void
+FlushFormatPlotfile::WriteFieldsAggregated (
+    const std::string& filename, int nlev,
+    const amrex::Vector<amrex::MultiFab>& mf,
+    const amrex::Vector<std::string>& varnames,
+    const amrex::Vector<amrex::Geometry>& geom,
+    const double time, const amrex::Vector<int>& iteration,
+    const amrex::Vector<std::string>& extra_dirs) const
+{
+    WARPX_PROFILE("FlushFormatPlotfile::WriteFieldsAggregated()");
+
+    amrex::PreBuildDirectorHierarchy(filename, default_level_prefix, nlev, true);
+    for (auto const& extra_dir : extra_dirs) {
+        amrex::PreBuildDirectorHierarchy(filename + "/" + extra_dir, default_level_prefix, nlev, true);
+    }
+    ParallelDescriptor::Barrier();
+
+    WritePlotfileHeader(filename, nlev, mf, varnames, geom, time, iteration);
+
+    // Rank of this process in its aggregation group, size of the group,
+    // and global rank of the aggregator, which names the file of the group
+    int group_rank = 0;
+    int group_size = 1;
+    int aggregator = ParallelDescriptor::MyProc();
+#ifdef AMREX_USE_MPI
+    MPI_Comm_rank(m_aggregation_comm, &group_rank);
+    MPI_Comm_size(m_aggregation_comm, &group_size);
+    MPI_Bcast(&aggregator, 1, MPI_INT, 0, m_aggregation_comm);
+#endif
+    const Long alignment = m_aggregate_io_alignment;
+    auto align_up = [alignment] (Long size) { return (size + alignment - 1) / alignment * alignment; };
+
+    for (int lev = 0; lev < nlev; ++lev) {
+        // Valid cells only, in host memory, as in VisMF::Write
+        MultiFab staging(mf[lev].boxArray(), mf[lev].DistributionMap(), mf[lev].nComp(), 0,
+                         MFInfo().SetArena(The_Pinned_Arena()));
+        MultiFab::Copy(staging, mf[lev], 0, 0, mf[lev].nComp(), 0);
+        Gpu::streamSynchronize();
+
+        // Header with the min and max of each FAB, which requires communications
+        VisMF::Header hdr(staging, VisMF::NFiles, VisMF::Header::Version_v1, true);
+
+        // Serialize the local FABs, each with its FAB header, in the current FAB format,
+        // directly into the buffer that is written or sent
+        Vector<char> local_data;
+        Long data_size = 0;
+        for (MFIter mfi(staging); mfi.isValid(); ++mfi) {
+            data_size += staging[mfi].box().numPts() * staging.nComp() * static_cast<Long>(sizeof(Real));
+        }
+        local_data.reserve(data_size);
+        AppendByteBuffer append_buffer(local_data);
+        std::ostream os(&append_buffer);
+        const int nboxes = static_cast<int>(staging.boxArray().size());
+        Vector<Long> fab_offset(nboxes, 0);
+        Vector<int> fab_file(nboxes, 0);
+        for (MFIter mfi(staging); mfi.isValid(); ++mfi) {
+            fab_offset[mfi.index()] = static_cast<Long>(local_data.size());
+            staging[mfi].writeOn(os);
+        }
+        Long local_size = static_cast<Long>(local_data.size());
+
+        // Offset of the data of each rank of the group in the file of the group
+        Vector<Long> sizes(group_size, local_size);
+#ifdef AMREX_USE_MPI
+        MPI_Allgather(&local_size, 1, ParallelDescriptor::Mpi_typemap<Long>::type(),
+                      sizes.data(), 1, ParallelDescriptor::Mpi_typemap<Long>::type(),
+                      m_aggregation_comm);
+#endif
+        Vector<Long> rank_offset(group_size, 0);
+        for (int r = 1; r < group_size; ++r) {
+            rank_offset[r] = rank_offset[r-1] + align_up(sizes[r-1]);
+        }
+        for (MFIter mfi(staging); mfi.isValid(); ++mfi) {
+            fab_offset[mfi.index()] += rank_offset[group_rank];
+            fab_file[mfi.index()] = aggregator;
+        }
+
+        // Only the aggregators write: first their own data, then the data of
+        // the other ranks of the group, one rank at a time to bound their memory use
+        const std::string level_prefix = amrex::MultiFabFileFullPrefix(lev, filename,
+                                                                       default_level_prefix, "Cell");
+        const std::string data_file_name = amrex::Concatenate("Cell_D_", aggregator, 5);
+        if (group_rank == 0) {
+            const std::string full_name = level_prefix.substr(0, level_prefix.rfind('/') + 1)
+                                          + data_file_name;
+            std::ofstream ofs(full_name.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+            if (!ofs.good()) amrex::FileOpenFailed(full_name);
+            ofs.write(local_data.data(), local_size);
+#ifdef AMREX_USE_MPI
+            Vector<char> recv_buffer;
+            for (int r = 1; r < group_size; ++r) {
+                if (sizes[r] == 0) continue;
+                recv_buffer.resize(sizes[r]);
+                RecvBytes(recv_buffer.data(), sizes[r], r, m_aggregation_comm);
+                ofs.seekp(rank_offset[r]);
+                ofs.write(recv_buffer.data(), sizes[r]);
+            }
+#endif
+            if (!ofs.good()) amrex::Abort("FlushFormatPlotfile: failed to write " + full_name);
+        }
+#ifdef AMREX_USE_MPI
+        else if (local_size > 0) {
+            SendBytes(local_data.data(), local_size, 0, m_aggregation_comm);
+        }
+#endif
+
+        // Gather the location of all the FABs on the I/O processor, which writes Cell_H
+        const int io_proc = ParallelDescriptor::IOProcessorNumber();
+        ParallelDescriptor::ReduceLongSum(fab_offset.data(), nboxes, io_proc);
+        ParallelDescriptor::ReduceIntSum(fab_file.data(), nboxes, io_proc);
+        if (ParallelDescriptor::IOProcessor()) {
+            hdr.m_fod.resize(nboxes);
+            for (int i = 0; i < nboxes; ++i) {
+                hdr.m_fod[i] = VisMF::FabOnDisk(amrex::Concatenate("Cell_D_", fab_file[i], 5),
+                                                fab_offset[i]);
+            }
+        }
+        VisMF::WriteHeader(level_prefix, hdr, io_proc);
+    }
+}
+
 void
 FlushFormatPlotfile::WriteJobInfo(const std::string& dir) const
 {
@@ -310,8 +627,6 @@ FlushFormatPlotfile::WriteParticles(const std::string& dir,
 
     for (unsigned i = 0, n = particle_diags.size(); i < n; ++i) {
         WarpXParticleContainer* pc = particle_diags[i].getParticleContainer();
-        amrex::AmrParticleContainer<0, 0, PIdx::nattribs, 0, amrex::PinnedArenaAllocator>
-            tmp(&WarpX::GetInstance());
         Vector<std::string> real_names;
         Vector<std::string> int_names;
         Vector<int> int_flags;
@@ -327,6 +642,21 @@ FlushFormatPlotfile::WriteParticles(const std::string& dir,
         real_names.push_back("theta");
 #endif
 
+        // Particles already in host memory and in SI units, e.g., back-transformed particles,
+        // are written as they are. They only have the PIdx components.
+        PinnedMemoryParticleContainer* pinned_pc = particle_diags[i].getPinnedParticleContainer();
+        if (pinned_pc) {
+            real_flags = particle_diags[i].plot_flags;
+            real_flags.resize(PIdx::nattribs);
+            pinned_pc->WritePlotFile(
+                dir, particle_diags[i].getSpeciesName(),
+                real_flags, int_flags,
+                real_names, int_names);
+            continue;
+        }
+
+        PinnedMemoryParticleContainer tmp(&WarpX::GetInstance());
+
         // add runtime real comps to tmp
         for (int ic = 0; ic < pc->NumRuntimeRealComps(); ++ic) { tmp.AddRealComp(false); }
 
@@ -352,26 +682,8 @@ FlushFormatPlotfile::WriteParticles(const std::string& dir,
 
         pc->ConvertUnits(ConvertDirection::WarpX_to_SI);
 
-        RandomFilter const random_filter(particle_diags[i].m_do_random_filter,
-                                         particle_diags[i].m_random_fraction);
-        UniformFilter const uniform_filter(particle_diags[i].m_do_uniform_filter,
-                                           particle_diags[i].m_uniform_stride);
-        ParserFilter parser_filter(particle_diags[i].m_do_parser_filter,
-                                   compileParser<ParticleDiag::m_nvars>
-                                       (particle_diags[i].m_particle_filter_parser.get()),
-                                   pc->getMass());
-        parser_filter.m_units = InputUnits::SI;
-        GeometryFilter const geometry_filter(particle_diags[i].m_do_geom_filter,
-                                             particle_diags[i].m_diag_domain);
-
-        using SrcData = WarpXParticleContainer::ParticleTileType::ConstParticleTileDataType;
-        tmp.copyParticles(*pc,
-                          [=] AMREX_GPU_HOST_DEVICE (const SrcData& src, int ip, const amrex::RandomEngine& engine)
-        {
-            const SuperParticleType& p = src.getSuperParticle(ip);
-            return random_filter(p, engine) * uniform_filter(p, engine)
-                * parser_filter(p, engine) * geometry_filter(p, engine);
-        }, true);
+        // Only the selected particles are copied to the host
+        filterAndCompactParticles(tmp, *pc, particle_diags[i].GetFilter());
 
         // real_names contains a list of all particle attributes.
         // real_flags & int_flags are 1 or 0, whether quantity is dumped or not.
@@ -3,6 +3,7 @@
 #include "ComputeDiagFunctors/CellCenterFunctor.H"
 #include "ComputeDiagFunctors/DivBFunctor.H"
 #include "ComputeDiagFunctors/DivEFunctor.H"
+#include "ComputeDiagFunctors/FusedCellCenterFunctor.H"
 #include "ComputeDiagFunctors/PartPerCellFunctor.H"
 #include "ComputeDiagFunctors/PartPerGridFunctor.H"
 #include "ComputeDiagFunctors/RhoFunctor.H"
@@ -11,10 +12,13 @@
 #include "FlushFormats/FlushFormat.H"
 #include "Particles/MultiParticleContainer.H"
 #include "Utils/WarpXAlgorithmSelection.H"
+#include "Utils/WarpXProfilerWrapper.H"
+#include "Utils/WarpXUtil.H"
 #include "WarpX.H"
 
 #include <AMReX.H>
 #include <AMReX_Array.H>
+#include <AMReX_Array4.H>
 #include <AMReX_BLassert.H>
 #include <AMReX_Box.H>
 #include <AMReX_BoxArray.H>
@@ -22,17 +26,23 @@
 #include <AMReX_CoordSys.H>
 #include <AMReX_DistributionMapping.H>
 #include <AMReX_Geometry.H>
+#include <AMReX_GpuControl.H>
+#include <AMReX_GpuLaunch.H>
+#include <AMReX_GpuQualifiers.H>
 #include <AMReX_IntVect.H>
 #include <AMReX_MakeType.H>
+#include <AMReX_MFIter.H>
 #include <AMReX_MultiFab.H>
 #include <AMReX_ParmParse.H>
 #include <AMReX_REAL.H>
 #include <AMReX_RealBox.H>
+#include <AMReX_Utility.H>
 #include <AMReX_Vector.H>
 
 #include <algorithm>
 #include <cmath>
 #include <memory>
+#include <string>
 #include <vector>
 
 using namespace amrex::literals;
@@ -52,6 +62,9 @@ FullDiagnostics::InitializeParticleBuffer ()
     // Initialize data in the base class Diagnostics
     auto & warpx = WarpX::GetInstance();
 
+    // Only fields are written in regions of interest
+    if (m_roi_writer) return;
+
     const MultiParticleContainer& mpc = warpx.GetPartContainer();
     // If not specified, dump all species
     if (m_output_species_names.empty()) m_output_species_names = mpc.GetSpeciesNames();
@@ -71,8 +84,8 @@ FullDiagnostics::ReadParameters ()
     AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
         m_format == "plotfile" || m_format == "openpmd" ||
         m_format == "checkpoint" || m_format == "ascent" ||
-        m_format == "sensei",
-        "<diag>.format must be plotfile or openpmd or checkpoint or ascent or sensei");
+        m_format == "sensei" || m_format == "in_transit",
+        "<diag>.format must be plotfile or openpmd or checkpoint or ascent or sensei or in_transit");
     std::vector<std::string> intervals_string_vec = {"0"};
     pp_diag_name.queryarr("intervals", intervals_string_vec);
     m_intervals = IntervalsParser(intervals_string_vec);
@@ -86,6 +99,33 @@ FullDiagnostics::ReadParameters ()
     amrex::ignore_unused(m_dump_rz_modes);
 #endif
 
+    pp_diag_name.query("time_average", m_time_average);
+    if (m_time_average) {
+        getWithParser(pp_diag_name, "average_period_steps", m_average_period_steps);
+        pp_diag_name.query("average_rms", m_average_rms);
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(m_average_period_steps >= 1,
+            m_diag_name + ".average_period_steps must be at least 1");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
+            m_format == "plotfile" || m_format == "openpmd" || m_format == "in_transit",
+            m_diag_name + ".time_average is only supported with format plotfile, openpmd or in_transit");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(raw_specified == false,
+            m_diag_name + ".time_average cannot be used together with raw field output");
+    }
+
+    if (pp_diag_name.contains("roi_names")) {
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(m_format == "plotfile",
+            m_diag_name + ".roi_names requires " + m_diag_name + ".format = plotfile");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(m_crse_ratio == amrex::IntVect(1),
+            m_diag_name + ".roi_names requires " + m_diag_name + ".coarsening_ratio = 1");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
+            !raw_specified && !m_time_average && !m_field_compression.IsActive(),
+            m_diag_name + ".roi_names cannot be used with raw fields, time averaging or compression");
+        // The fields are written directly from the simulation MultiFabs:
+        // nothing is computed nor packed in m_mf_output.
+        m_roi_writer = std::make_unique<RegionOfInterestWriter>(m_diag_name, m_varnames);
+        m_varnames.clear();
+    }
+
     if (m_format == "checkpoint"){
         AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
             raw_specified == false &&
@@ -110,14 +150,27 @@ FullDiagnostics::BackwardCompatibility ()
 }
 
 void
-FullDiagnostics::Flush ( int i_buffer )
+FullDiagnostics::Flush ( int i_buffer, bool /*force_flush*/ )
 {
     // This function should be moved to Diagnostics when plotfiles/openpmd format
     // is supported for BackTransformed Diagnostics, in BTDiagnostics class.
     auto & warpx = WarpX::GetInstance();
 
+    if (m_roi_writer) {
+        m_roi_writer->WriteToFile(
+            amrex::Concatenate(m_file_prefix, warpx.getistep(0), m_file_min_digits),
+            nlev_output, warpx.getistep(0), warpx.gett_new(0));
+        return;
+    }
+
+    // With RMS time averaging, the RMS of each field is stored after the averaged fields
+    amrex::Vector<std::string> varnames = m_varnames;
+    if (m_time_average && m_average_rms) {
+        for (auto const& name : m_varnames) varnames.push_back(name + "_rms");
+    }
+
     m_flush_format->WriteToFile(
-        m_varnames, m_mf_output[i_buffer], m_geom_output[i_buffer], warpx.getistep(),
+        varnames, m_mf_output[i_buffer], m_geom_output[i_buffer], warpx.getistep(),
         warpx.gett_new(0), m_output_species, nlev_output, m_file_prefix, m_file_min_digits,
         m_plot_raw_fields, m_plot_raw_fields_guards, m_plot_raw_rho, m_plot_raw_F);
 
@@ -147,9 +200,98 @@ FullDiagnostics::DoComputeAndPack (int step, bool force_flush)
     if (force_flush || m_intervals.contains(step+1) ){
         return true;
     }
+    // With time averaging, data must also be computed and packed at every step
+    // of the averaging window that precedes the next output.
+    if (m_time_average) {
+        const int next_output = m_intervals.nextContains(step+1);
+        if (next_output - (step+1) < m_average_period_steps) return true;
+    }
     return false;
 }
 
+void
+FullDiagnostics::AccumulateFieldBuffers ()
+{
+    if (!m_time_average) return;
+    WARPX_PROFILE("FullDiagnostics::AccumulateFieldBuffers()");
+
+    const int nvar = static_cast<int>(m_varnames.size());
+    const int ncomp_sum = m_average_rms ? 2*nvar : nvar;
+    if (static_cast<int>(m_mf_sum.size()) != nlev_output) m_mf_sum.resize(nlev_output);
+    for (int lev = 0; lev < nlev_output; ++lev) {
+        amrex::MultiFab const& mf_out = m_mf_output[0][lev];
+        amrex::MultiFab& mf_sum = m_mf_sum[lev];
+        // (Re-)allocate the running sums if needed, e.g., after a regrid.
+        // This drops the steps accumulated so far on all levels.
+        if (!mf_sum.ok() || mf_sum.boxArray() != mf_out.boxArray()
+            || mf_sum.DistributionMap() != mf_out.DistributionMap()
+            || mf_sum.nComp() != ncomp_sum) {
+            mf_sum.define(mf_out.boxArray(), mf_out.DistributionMap(), ncomp_sum, 0);
+            for (int l = 0; l < nlev_output; ++l) {
+                if (m_mf_sum[l].ok()) m_mf_sum[l].setVal(0._rt);
+            }
+            m_num_averaged_steps = 0;
+        }
+    }
+
+    const bool rms = m_average_rms;
+    for (int lev = 0; lev < nlev_output; ++lev) {
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+        for (amrex::MFIter mfi(m_mf_sum[lev], amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const amrex::Box& bx = mfi.tilebox();
+            amrex::Array4<amrex::Real const> const& out = m_mf_output[0][lev].const_array(mfi);
+            amrex::Array4<amrex::Real> const& sum = m_mf_sum[lev].array(mfi);
+            // Sum and sum of squares of all fields, in a single kernel
+            amrex::ParallelFor(bx, nvar,
+                [=] AMREX_GPU_DEVICE (int i, int j, int k, int n)
+                {
+                    const amrex::Real v = out(i,j,k,n);
+                    sum(i,j,k,n) += v;
+                    if (rms) sum(i,j,k,n+nvar) += v*v;
+                });
+        }
+    }
+    ++m_num_averaged_steps;
+}
+
+void
+FullDiagnostics::PrepareFieldBufferForFlush (int i_buffer)
+{
+    if (!m_time_average) return;
+    WARPX_PROFILE("FullDiagnostics::PrepareFieldBufferForFlush()");
+    AMREX_ALWAYS_ASSERT(m_num_averaged_steps > 0);
+
+    const int nvar = static_cast<int>(m_varnames.size());
+    const amrex::Real inv_n = 1._rt / static_cast<amrex::Real>(m_num_averaged_steps);
+    const bool rms = m_average_rms;
+    for (int lev = 0; lev < nlev_output; ++lev) {
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+        for (amrex::MFIter mfi(m_mf_sum[lev], amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const amrex::Box& bx = mfi.tilebox();
+            amrex::Array4<amrex::Real> const& out = m_mf_output[i_buffer][lev].array(mfi);
+            amrex::Array4<amrex::Real> const& sum = m_mf_sum[lev].array(mfi);
+            // Write the averages to the output buffer and reset the running sums
+            amrex::ParallelFor(bx, nvar,
+                [=] AMREX_GPU_DEVICE (int i, int j, int k, int n)
+                {
+                    out(i,j,k,n) = sum(i,j,k,n) * inv_n;
+                    sum(i,j,k,n) = 0._rt;
+                    if (rms) {
+                        out(i,j,k,n+nvar) = std::sqrt(sum(i,j,k,n+nvar) * inv_n);
+                        sum(i,j,k,n+nvar) = 0._rt;
+                    }
+                });
+        }
+    }
+    m_num_averaged_steps = 0;
+}
+
 
 void
 FullDiagnostics::AddRZModesToDiags (int lev)
@@ -368,7 +510,13 @@ FullDiagnostics::InitializeFieldBufferData (int i_buffer, int lev ) {
     // Allocate output MultiFab for diagnostics. The data will be stored at cell-centers.
     int ngrow = (m_format == "sensei" || m_format == "ascent") ? 1 : 0;
     // The zero is hard-coded since the number of output buffers = 1 for FullDiagnostics
-    m_mf_output[i_buffer][lev] = amrex::MultiFab(ba, dmap, m_varnames.size(), ngrow);
+    // With RMS time averaging, the RMS of each field is stored after the averaged fields.
+    const int nvar = static_cast<int>(m_varnames.size());
+    const int ncomp_output = (m_time_average && m_average_rms) ? 2*nvar : nvar;
+    // No output MultiFab is needed when the fields are written in regions of interest
+    if (!m_roi_writer) {
+        m_mf_output[i_buffer][lev] = amrex::MultiFab(ba, dmap, ncomp_output, ngrow);
+    }
 
 
     if (lev == 0) {
@@ -397,6 +545,12 @@ FullDiagnostics::InitializeFieldFunctors (int lev)
     // Clear any pre-existing vector to release stored data.
     m_all_field_functors[lev].clear();
 
+    // Fields written in regions of interest do not need functors
+    if (m_roi_writer) {
+        m_roi_writer->InitializeFields(lev);
+        return;
+    }
+
     // Species index to loop over species that dump rho per species
     int i = 0;
 
@@ -491,6 +645,8 @@ FullDiagnostics::InitializeFieldFunctors (int lev)
         }
     }
     AddRZModesToDiags( lev );
+    // Cell-center consecutive fields, e.g. Ex Ey Ez Bx By Bz, in a single pass
+    FuseCellCenterFunctors( m_all_field_functors[lev], lev, m_crse_ratio );
 }
 
 
@@ -94,3 +94,11 @@ MultiDiagnostics::NewIteration ()
         diag->NewIteration();
     }
 }
+
+void
+MultiDiagnostics::BackTransformParticles (amrex::Real t_boost, amrex::Real dt)
+{
+    for( auto& diag : alldiags ){
+        diag->BackTransformParticles(t_boost, dt);
+    }
+}
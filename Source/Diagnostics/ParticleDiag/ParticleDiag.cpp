@@ -1,6 +1,7 @@
 #include "ParticleDiag.H"
 
 #include "Diagnostics/ParticleDiag/ParticleDiag.H"
+#include "Particles/Filter/FilterFunctors.H"
 #include "Particles/WarpXParticleContainer.H"
 #include "Utils/WarpXUtil.H"
 #include "WarpX.H"
@@ -12,8 +13,9 @@
 
 using namespace amrex;
 
-ParticleDiag::ParticleDiag(std::string diag_name, std::string name, WarpXParticleContainer* pc)
-    : m_diag_name(diag_name), m_name(name), m_pc(pc)
+ParticleDiag::ParticleDiag(std::string diag_name, std::string name, WarpXParticleContainer* pc,
+                           PinnedMemoryParticleContainer* pinned_pc)
+    : m_diag_name(diag_name), m_name(name), m_pc(pc), m_pinned_pc(pinned_pc)
 {
     ParmParse pp(diag_name + "." + name);
     if (!pp.queryarr("variables", variables)){
@@ -22,9 +24,6 @@ ParticleDiag::ParticleDiag(std::string diag_name, std::string name, WarpXParticl
 
     //variable to set plot_flags size
     int plot_flag_size = PIdx::nattribs;
-    if(WarpX::do_back_transformed_diagnostics && m_pc->doBackTransformedDiagnostics())
-        // Also output old values for position and momenta
-        plot_flag_size += 6;
 
 #ifdef WARPX_QED
     if(m_pc->DoQED()){
@@ -74,6 +73,7 @@ ParticleDiag::ParticleDiag(std::string diag_name, std::string name, WarpXParticl
     // build filter functors
     m_do_random_filter = queryWithParser(pp, "random_fraction", m_random_fraction);
     m_do_uniform_filter = pp.query("uniform_stride",  m_uniform_stride);
+    m_do_momentum_filter = queryWithParser(pp, "momentum_threshold", m_momentum_threshold);
     std::string buf;
     m_do_parser_filter = pp.query("plot_filter_function(t,x,y,z,ux,uy,uz)", buf);
 
@@ -85,3 +85,19 @@ ParticleDiag::ParticleDiag(std::string diag_name, std::string name, WarpXParticl
             makeParser(function_string,{"t","x","y","z","ux","uy","uz"}));
     }
 }
+
+ParticleDiagFilter
+ParticleDiag::GetFilter () const
+{
+    RandomFilter const random_filter(m_do_random_filter, m_random_fraction);
+    UniformFilter const uniform_filter(m_do_uniform_filter, m_uniform_stride);
+    ParserFilter parser_filter(m_do_parser_filter,
+                               compileParser<m_nvars>(m_particle_filter_parser.get()),
+                               m_pc->getMass());
+    parser_filter.m_units = InputUnits::SI;
+    GeometryFilter const geometry_filter(m_do_geom_filter, m_diag_domain);
+    MomentumFilter momentum_filter(m_do_momentum_filter, m_momentum_threshold, m_pc->getMass());
+    momentum_filter.m_units = InputUnits::SI;
+    return ParticleDiagFilter{geometry_filter, uniform_filter, momentum_filter,
+                              parser_filter, random_filter};
+}
@@ -0,0 +1,73 @@
+/* Copyright 2026 The WarpX Community
+ *
+ * This file is part of WarpX.
+ *
+ * License: BSD-3-Clause-LBNL
+ */
+#include "ParticleTileReallocations.H"
+
+#include "Diagnostics/ReducedDiags/ReducedDiags.H"
+#include "Particles/ParticleCreation/ParticleTileCapacity.H"
+#include "Utils/IntervalsParser.H"
+
+#include <AMReX_INT.H>
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_REAL.H>
+
+#include <ostream>
+#include <vector>
+
+using namespace amrex::literals;
+
+// constructor
+ParticleTileReallocations::ParticleTileReallocations (std::string rd_name)
+    : ReducedDiags{rd_name}
+{
+    // resize data array
+    m_data.resize(2, 0.0_rt);
+
+    if (amrex::ParallelDescriptor::IOProcessor())
+    {
+        if ( m_IsNotRestart )
+        {
+            // open file
+            std::ofstream ofs{m_path + m_rd_name + "." + m_extension, std::ofstream::out};
+
+            // write header row
+            int c = 0;
+            ofs << "#";
+            ofs << "[" << c++ << "]step()";
+            ofs << m_sep;
+            ofs << "[" << c++ << "]time(s)";
+            ofs << m_sep;
+            ofs << "[" << c++ << "]reallocations()";
+            ofs << m_sep;
+            ofs << "[" << c++ << "]bytes_moved(B)";
+            ofs << std::endl;
+
+            // close file
+            ofs.close();
+        }
+    }
+}
+
+// Get the number of reallocations of the particle tiles
+void ParticleTileReallocations::ComputeDiags (int step)
+{
+    // Judge if the diags should be done
+    if (!m_intervals.contains(step+1)) { return; }
+
+    // sum over the MPI ranks
+    amrex::Long counts[2] = {ParticleTileCapacity::numReallocations(),
+                             ParticleTileCapacity::bytesMoved()};
+    amrex::ParallelDescriptor::ReduceLongSum(
+        counts, 2, amrex::ParallelDescriptor::IOProcessorNumber());
+
+    // save data
+    m_data[0] = static_cast<amrex::Real>(counts[0]);
+    m_data[1] = static_cast<amrex::Real>(counts[1]);
+
+    /* m_data now contains up-to-date values for:
+     *  [number of reallocations of particle tiles since the start of the simulation,
+     *   number of bytes copied by these reallocations] */
+}
@@ -0,0 +1,280 @@
+#include "RegionOfInterestWriter.H"
+
+#include "Utils/WarpXProfilerWrapper.H"
+#include "Utils/WarpXUtil.H"
+#include "WarpX.H"
+
+#include <AMReX.H>
+#include <AMReX_Array4.H>
+#include <AMReX_BLassert.H>
+#include <AMReX_BoxArray.H>
+#include <AMReX_Config.H>
+#include <AMReX_DistributionMapping.H>
+#include <AMReX_FabConv.H>
+#include <AMReX_Geometry.H>
+#include <AMReX_GpuContainers.H>
+#include <AMReX_GpuDevice.H>
+#include <AMReX_GpuLaunch.H>
+#include <AMReX_GpuQualifiers.H>
+#include <AMReX_IndexType.H>
+#include <AMReX_INT.H>
+#include <AMReX_IntVect.H>
+#include <AMReX_MultiFab.H>
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_ParmParse.H>
+#include <AMReX_Print.H>
+#include <AMReX_Utility.H>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace
+{
+    /** FAB header of a region of ncomp components, in native binary format,
+     *  as written by amrex::FArrayBox::writeOn */
+    std::string
+    FabHeader (const amrex::Box& bx, int ncomp)
+    {
+        std::ostringstream os;
+        os << "FAB " << amrex::FPC::NativeRealDescriptor() << bx << ' ' << ncomp << '\n';
+        return os.str();
+    }
+
+    /** Write components [comp, comp+ncomp) of arr in region bx to os, in Fortran order.
+     *  On CPU, the data is written directly from the field, one row at a time;
+     *  on GPU, it is first copied to a pinned buffer of the size of the region.
+     */
+    void
+    WriteRegion (std::ostream& os, amrex::Array4<amrex::Real const> const& arr,
+                 const amrex::Box& bx, int comp, int ncomp)
+    {
+        const amrex::Dim3 lo = amrex::lbound(bx);
+        const amrex::Dim3 hi = amrex::ubound(bx);
+        const amrex::Dim3 len = amrex::length(bx);
+#ifdef AMREX_USE_GPU
+        amrex::Gpu::PinnedVector<amrex::Real> buffer(bx.numPts()*ncomp);
+        amrex::Real * const AMREX_RESTRICT p = buffer.data();
+        amrex::ParallelFor(bx, ncomp,
+            [=] AMREX_GPU_DEVICE (int i, int j, int k, int n)
+            {
+                const amrex::Long idx = (i - lo.x) + len.x*( (j - lo.y)
+                                      + static_cast<amrex::Long>(len.y)*( (k - lo.z)
+                                      + static_cast<amrex::Long>(len.z)*n ) );
+                p[idx] = arr(i,j,k,comp+n);
+            });
+        amrex::Gpu::streamSynchronize();
+        os.write(reinterpret_cast<const char*>(p), buffer.size()*sizeof(amrex::Real));
+        amrex::ignore_unused(hi);
+#else
+        for (int n = comp; n < comp+ncomp; ++n) {
+            for (int k = lo.z; k <= hi.z; ++k) {
+                for (int j = lo.y; j <= hi.y; ++j) {
+                    os.write(reinterpret_cast<const char*>(arr.ptr(lo.x,j,k,n)),
+                             len.x*sizeof(amrex::Real));
+                }
+            }
+        }
+#endif
+    }
+}
+
+RegionOfInterestWriter::RegionOfInterestWriter (const std::string& diag_name,
+                                                const amrex::Vector<std::string>& varnames)
+    : m_varnames(varnames)
+{
+    amrex::ParmParse pp_diag_name(diag_name);
+    pp_diag_name.getarr("roi_names", m_roi_names);
+    for (auto const& roi : m_roi_names) {
+        amrex::ParmParse pp_roi(diag_name + "." + roi);
+        amrex::Vector<amrex::Real> lo(AMREX_SPACEDIM), hi(AMREX_SPACEDIM);
+        getArrWithParser(pp_roi, "lo", lo, 0, AMREX_SPACEDIM);
+        getArrWithParser(pp_roi, "hi", hi, 0, AMREX_SPACEDIM);
+        for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
+            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(lo[idim] <= hi[idim],
+                diag_name + "." + roi + ".lo must be lower than " + diag_name + "." + roi + ".hi");
+        }
+        m_roi_lo.push_back(lo);
+        m_roi_hi.push_back(hi);
+    }
+    m_fields.resize(WarpX::GetInstance().maxLevel() + 1);
+}
+
+void
+RegionOfInterestWriter::InitializeFields (int lev)
+{
+    auto & warpx = WarpX::GetInstance();
+
+    m_fields[lev].clear();
+    const amrex::Vector<std::string> xyz = {"x", "y", "z"};
+    for (auto const& var : m_varnames) {
+        FieldSource src;
+        for (int dir = 0; dir < 3; ++dir) {
+            if (var == "E" + xyz[dir]) src.mf = warpx.get_pointer_Efield_aux(lev, dir);
+            if (var == "B" + xyz[dir]) src.mf = warpx.get_pointer_Bfield_aux(lev, dir);
+            if (var == "j" + xyz[dir]) src.mf = warpx.get_pointer_current_fp(lev, dir);
+#ifdef WARPX_MAG_LLG
+            if (var == "H" + xyz[dir]) src.mf = warpx.get_pointer_Hfield_aux(lev, dir);
+#endif
+        }
+        // Multi-mode fields (RZ) are written with all their components
+        if (src.mf) src.ncomp = src.mf->nComp();
+#ifdef WARPX_MAG_LLG
+        // M stores all 3 components of the magnetization on each face,
+        // e.g. My_xface is component 1 of Mfield_aux[0]
+        for (int face = 0; face < 3; ++face) {
+            for (int comp = 0; comp < 3; ++comp) {
+                if (var == "M" + xyz[comp] + "_" + xyz[face] + "face") {
+                    src.mf = warpx.get_pointer_Mfield_aux(lev, face);
+                    src.comp = comp;
+                    src.ncomp = 1;
+                }
+            }
+        }
+#endif
+        if (src.mf == nullptr) {
+            amrex::Abort("Error: " + var + " is not a field supported by the region-of-interest output. "
+                         "Supported fields are the components of E, B and j"
+#ifdef WARPX_MAG_LLG
+                         ", H and M"
+#endif
+                         ".");
+        }
+        m_fields[lev].push_back(src);
+    }
+}
+
+void
+RegionOfInterestWriter::ForEachIntersection (
+    int lev,
+    const std::function<void(int, int, int, const amrex::Box&)>& f) const
+{
+    const amrex::Geometry& geom = WarpX::GetInstance().Geom(lev);
+    const amrex::Box& domain = geom.Domain();
+
+    // Cell-centered index box of each region at this level
+    amrex::Vector<amrex::Box> roi_boxes;
+    for (int iroi = 0; iroi < m_roi_names.size(); ++iroi) {
+        amrex::IntVect lo, hi;
+        for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
+            const amrex::Real dx = geom.CellSize(idim);
+            lo[idim] = static_cast<int>(std::floor((m_roi_lo[iroi][idim] - geom.ProbLo(idim)) / dx));
+            hi[idim] = static_cast<int>(std::ceil((m_roi_hi[iroi][idim] - geom.ProbLo(idim)) / dx)) - 1;
+            // At least one cell in each direction
+            hi[idim] = std::max(hi[idim], lo[idim]);
+        }
+        roi_boxes.push_back(amrex::Box(lo, hi) & domain);
+    }
+
+    for (int ifield = 0; ifield < m_fields[lev].size(); ++ifield) {
+        const amrex::MultiFab& mf = *m_fields[lev][ifield].mf;
+        const amrex::IndexType ixtype = mf.ixType();
+        const amrex::Box nodal_domain = amrex::convert(domain, ixtype);
+        const amrex::BoxArray& ba = mf.boxArray();
+        for (int ibox = 0; ibox < static_cast<int>(ba.size()); ++ibox) {
+            amrex::Box vbx = ba[ibox];
+            // Nodal points on the upper face of a box are also on the lower face of
+            // its neighbor: only keep them for boxes at the upper end of the domain.
+            for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
+                if (ixtype.nodeCentered(idim) && vbx.bigEnd(idim) < nodal_domain.bigEnd(idim)) {
+                    vbx.growHi(idim, -1);
+                }
+            }
+            for (int iroi = 0; iroi < roi_boxes.size(); ++iroi) {
+                if (!roi_boxes[iroi].ok()) continue;
+                const amrex::Box region = vbx & amrex::convert(roi_boxes[iroi], ixtype);
+                if (region.ok()) f(ifield, iroi, ibox, region);
+            }
+        }
+    }
+}
+
+void
+RegionOfInterestWriter::WriteToFile (const std::string& dirname, int nlev,
+                                     int iteration, amrex::Real time) const
+{
+    WARPX_PROFILE("RegionOfInterestWriter::WriteToFile()");
+
+    amrex::Print() << "  Writing regions of interest " << dirname << "\n";
+    amrex::UtilCreateCleanDirectory(dirname, true);
+
+    const int myproc = amrex::ParallelDescriptor::MyProc();
+    const int nprocs = amrex::ParallelDescriptor::NProcs();
+    const std::string data_prefix = "Data_";
+
+    // Each rank writes the regions of the boxes it owns, directly from the field data.
+    // The file is only created by ranks that own data in at least one region.
+    std::ofstream ofs;
+    for (int lev = 0; lev < nlev; ++lev) {
+        ForEachIntersection(lev,
+            [&] (int ifield, int /*iroi*/, int ibox, const amrex::Box& region)
+            {
+                FieldSource const& src = m_fields[lev][ifield];
+                if (src.mf->DistributionMap()[ibox] != myproc) return;
+                if (!ofs.is_open()) {
+                    const std::string filename = dirname + "/"
+                                                 + amrex::Concatenate(data_prefix, myproc, 5);
+                    ofs.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+                    if (!ofs.good()) amrex::FileOpenFailed(filename);
+                }
+                ofs << FabHeader(region, src.ncomp);
+                WriteRegion(ofs, src.mf->const_array(ibox), region, src.comp, src.ncomp);
+            });
+    }
+    if (ofs.is_open()) {
+        ofs.close();
+        if (!ofs.good()) amrex::Abort("RegionOfInterestWriter: error writing data of " + dirname);
+    }
+
+    // The layout is known on all ranks, so the I/O processor can compute the file
+    // and offset of every region without communication.
+    if (amrex::ParallelDescriptor::IOProcessor()) {
+        const std::string header_name = dirname + "/Header";
+        std::ofstream header(header_name);
+        if (!header.good()) amrex::FileOpenFailed(header_name);
+        header << std::setprecision(17);
+        header << "WarpX-ROI-V1\n";
+        header << iteration << "\n" << time << "\n";
+        header << nlev << "\n";
+        auto & warpx = WarpX::GetInstance();
+        for (int lev = 0; lev < nlev; ++lev) {
+            for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) header << warpx.Geom(lev).ProbLo(idim) << " ";
+            for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) header << warpx.Geom(lev).CellSize(idim) << " ";
+            header << "\n";
+        }
+        header << m_roi_names.size() << "\n";
+        for (int iroi = 0; iroi < m_roi_names.size(); ++iroi) {
+            header << m_roi_names[iroi];
+            for (auto const v : m_roi_lo[iroi]) header << " " << v;
+            for (auto const v : m_roi_hi[iroi]) header << " " << v;
+            header << "\n";
+        }
+        header << m_varnames.size() << "\n";
+        for (auto const& var : m_varnames) header << var << "\n";
+
+        // One line per FAB: level field_index roi_index file offset
+        std::ostringstream entries;
+        int nentries = 0;
+        amrex::Vector<amrex::Long> offsets(nprocs, 0);
+        for (int lev = 0; lev < nlev; ++lev) {
+            ForEachIntersection(lev,
+                [&] (int ifield, int iroi, int ibox, const amrex::Box& region)
+                {
+                    FieldSource const& src = m_fields[lev][ifield];
+                    const int owner = src.mf->DistributionMap()[ibox];
+                    entries << lev << " " << ifield << " " << iroi << " "
+                            << amrex::Concatenate(data_prefix, owner, 5) << " "
+                            << offsets[owner] << "\n";
+                    offsets[owner] += FabHeader(region, src.ncomp).size()
+                                      + region.numPts()*src.ncomp*sizeof(amrex::Real);
+                    ++nentries;
+                });
+        }
+        header << nentries << "\n" << entries.str();
+        header.close();
+        if (!header.good()) amrex::Abort("RegionOfInterestWriter: error writing " + header_name);
+    }
+}
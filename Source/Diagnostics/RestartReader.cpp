@@ -0,0 +1,58 @@
+#include "RestartReader.H"
+
+#include "Utils/WarpXProfilerWrapper.H"
+
+#include <AMReX_BLassert.H>
+#include <AMReX_Box.H>
+#include <AMReX_BoxArray.H>
+#include <AMReX_DistributionMapping.H>
+#include <AMReX_IntVect.H>
+#include <AMReX_MultiFab.H>
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_Vector.H>
+#include <AMReX_VisMF.H>
+
+#include <utility>
+#include <vector>
+
+using namespace amrex;
+
+void
+RestartReader::Read (MultiFab& mf, const std::string& name)
+{
+    WARPX_PROFILE("RestartReader::Read()");
+
+    // Only the header is read here
+    const VisMF vismf(name);
+    const BoxArray& ba_file = vismf.boxArray();
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(vismf.nComp() == mf.nComp(),
+        "Number of components of " + name + " does not match the simulation");
+
+    if (ba_file == mf.boxArray() && vismf.nGrowVect() == mf.nGrowVect()) {
+        VisMF::Read(mf, name);
+        return;
+    }
+
+    // Each box of the file is assigned to the rank of the new layout
+    // that owns the largest part of it.
+    const DistributionMapping& dm = mf.DistributionMap();
+    Vector<int> pmap(ba_file.size());
+    for (int i = 0; i < ba_file.size(); ++i) {
+        const std::vector<std::pair<int,Box>> isects = mf.boxArray().intersections(ba_file[i]);
+        Long max_npts = -1;
+        int owner = i % ParallelDescriptor::NProcs();
+        for (auto const& isect : isects) {
+            const Long npts = isect.second.numPts();
+            if (npts > max_npts) {
+                max_npts = npts;
+                owner = dm[isect.first];
+            }
+        }
+        pmap[i] = owner;
+    }
+
+    MultiFab mf_file(ba_file, DistributionMapping(std::move(pmap)), vismf.nComp(), vismf.nGrowVect());
+    VisMF::Read(mf_file, name);
+    mf.ParallelCopy(mf_file, 0, 0, mf.nComp(), mf_file.nGrowVect(),
+                    amrex::min(mf_file.nGrowVect(), mf.nGrowVect()));
+}
@@ -8,9 +8,10 @@
  * License: BSD-3-Clause-LBNL
  */
 #include "BoundaryConditions/PML.H"
-#include "FieldIO.H"
+#include "FieldSolver/FiniteDifferenceSolver/MacroscopicProperties/MacroscopicProperties.H"
 #include "Particles/MultiParticleContainer.H"
-#include "Utils/CoarsenIO.H"
+#include "RestartReader.H"
+#include "Utils/WarpXAlgorithmSelection.H"
 #include "Utils/WarpXProfilerWrapper.H"
 #include "WarpX.H"
 
@@ -24,16 +25,19 @@
 #include <AMReX_IntVect.H>
 #include <AMReX_MultiFab.H>
 #include <AMReX_ParallelDescriptor.H>
+#include <AMReX_ParmParse.H>
 #include <AMReX_PlotFileUtil.H>
 #include <AMReX_Print.H>
 #include <AMReX_REAL.H>
 #include <AMReX_RealBox.H>
+#include <AMReX_Utility.H>
 #include <AMReX_Vector.H>
 #include <AMReX_VisMF.H>
 
 #include <array>
 #include <istream>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <utility>
 
@@ -42,6 +46,33 @@ using namespace amrex;
 namespace
 {
     const std::string level_prefix {"Level_"};
+
+    /** Path of a complete node-local copy of checkpoint chkfile, written by a checkpoint
+     *  diagnostics with <diag_name>.local_dir, or an empty string if none is available
+     *  on all ranks.
+     * \param[in] chkfile path of the checkpoint on the parallel file system
+     */
+    std::string
+    LocalCheckpointCopy (const std::string& chkfile)
+    {
+        ParmParse pp_diagnostics("diagnostics");
+        Vector<std::string> diags_names;
+        pp_diagnostics.queryarr("diags_names", diags_names);
+        const std::string basename = chkfile.substr(chkfile.find_last_of('/') + 1);
+        for (auto const& diag_name : diags_names) {
+            ParmParse pp_diag_name(diag_name);
+            std::string format, local_dir;
+            pp_diag_name.query("format", format);
+            pp_diag_name.query("local_dir", local_dir);
+            if (format != "checkpoint" || local_dir.empty()) continue;
+            const std::string candidate = local_dir + "/" + basename;
+            // The copy is only complete if written on a single node
+            bool complete = amrex::FileExists(candidate + "/LocalComplete");
+            ParallelDescriptor::ReduceBoolAnd(complete);
+            if (complete) return candidate;
+        }
+        return std::string();
+    }
 }
 
 void
@@ -56,6 +87,14 @@ WarpX::InitFromCheckpoint ()
 {
     WARPX_PROFILE("WarpX::InitFromCheckpoint()");
 
+    // Prefer the node-local copy of the checkpoint, when it is still there
+    const std::string local_chkfile = LocalCheckpointCopy(restart_chkfile);
+    if (!local_chkfile.empty()) {
+        amrex::Print() << "  Using node-local copy " << local_chkfile
+                       << " of checkpoint " << restart_chkfile << "\n";
+        restart_chkfile = local_chkfile;
+    }
+
     amrex::Print() << "  Restart from checkpoint " << restart_chkfile << "\n";
 
     // Header
@@ -156,6 +195,11 @@ WarpX::InitFromCheckpoint ()
             BoxArray ba;
             ba.readFrom(is);
             GotoNextLine(is);
+            if (restart_regrid) {
+                // Merge the boxes of the checkpoint and chop them with the current max_grid_size
+                ba = BoxArray(ba.simplified_list());
+                ba.maxSize(maxGridSize(lev));
+            }
             DistributionMapping dm { ba, ParallelDescriptor::NProcs() };
             SetBoxArray(lev, ba);
             SetDistributionMap(lev, dm);
@@ -185,6 +229,7 @@ WarpX::InitFromCheckpoint ()
             Efield_fp[lev][i]->setVal(0.0);
             Bfield_fp[lev][i]->setVal(0.0);
 #ifdef WARPX_MAG_LLG
+            Hfield_fp[lev][i]->setVal(0.0);
             Mfield_fp[lev][i]->setVal(0.0);
 #endif
         }
@@ -194,81 +239,97 @@ WarpX::InitFromCheckpoint ()
                 Efield_aux[lev][i]->setVal(0.0);
                 Bfield_aux[lev][i]->setVal(0.0);
 #ifdef WARPX_MAG_LLG
+                Hfield_aux[lev][i]->setVal(0.0);
                 Mfield_aux[lev][i]->setVal(0.0);
 #endif
                 current_cp[lev][i]->setVal(0.0);
                 Efield_cp[lev][i]->setVal(0.0);
                 Bfield_cp[lev][i]->setVal(0.0);
 #ifdef WARPX_MAG_LLG
+                Hfield_cp[lev][i]->setVal(0.0);
                 Mfield_cp[lev][i]->setVal(0.0);
 #endif
             }
         }
 
-        VisMF::Read(*Efield_fp[lev][0],
-                    amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Ex_fp"));
-        VisMF::Read(*Efield_fp[lev][1],
-                    amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Ey_fp"));
-        VisMF::Read(*Efield_fp[lev][2],
-                    amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Ez_fp"));
+        RestartReader::Read(*Efield_fp[lev][0],
+                            amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Ex_fp"));
+        RestartReader::Read(*Efield_fp[lev][1],
+                            amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Ey_fp"));
+        RestartReader::Read(*Efield_fp[lev][2],
+                            amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Ez_fp"));
 
-        VisMF::Read(*Bfield_fp[lev][0],
-                    amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Bx_fp"));
-        VisMF::Read(*Bfield_fp[lev][1],
-                    amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "By_fp"));
-        VisMF::Read(*Bfield_fp[lev][2],
-                    amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Bz_fp"));
+        RestartReader::Read(*Bfield_fp[lev][0],
+                            amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Bx_fp"));
+        RestartReader::Read(*Bfield_fp[lev][1],
+                            amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "By_fp"));
+        RestartReader::Read(*Bfield_fp[lev][2],
+                            amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Bz_fp"));
 
 #ifdef WARPX_MAG_LLG
-        VisMF::Read(*Mfield_fp[lev][0],
-                    amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Mx_fp"));
-        VisMF::Read(*Mfield_fp[lev][1],
-                    amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "My_fp"));
-        VisMF::Read(*Mfield_fp[lev][2],
-                    amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Mz_fp"));
+        RestartReader::Read(*Hfield_fp[lev][0],
+                            amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Hx_fp"));
+        RestartReader::Read(*Hfield_fp[lev][1],
+                            amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Hy_fp"));
+        RestartReader::Read(*Hfield_fp[lev][2],
+                            amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Hz_fp"));
+
+        RestartReader::Read(*Mfield_fp[lev][0],
+                            amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Mx_fp"));
+        RestartReader::Read(*Mfield_fp[lev][1],
+                            amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "My_fp"));
+        RestartReader::Read(*Mfield_fp[lev][2],
+                            amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Mz_fp"));
 #endif
 
         if (is_synchronized) {
-            VisMF::Read(*current_fp[lev][0],
-                        amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "jx_fp"));
-            VisMF::Read(*current_fp[lev][1],
-                        amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "jy_fp"));
-            VisMF::Read(*current_fp[lev][2],
-                        amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "jz_fp"));
+            RestartReader::Read(*current_fp[lev][0],
+                                amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "jx_fp"));
+            RestartReader::Read(*current_fp[lev][1],
+                                amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "jy_fp"));
+            RestartReader::Read(*current_fp[lev][2],
+                                amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "jz_fp"));
         }
 
         if (lev > 0)
         {
-            VisMF::Read(*Efield_cp[lev][0],
-                        amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Ex_cp"));
-            VisMF::Read(*Efield_cp[lev][1],
-                        amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Ey_cp"));
-            VisMF::Read(*Efield_cp[lev][2],
-                        amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Ez_cp"));
-
-            VisMF::Read(*Bfield_cp[lev][0],
-                        amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Bx_cp"));
-            VisMF::Read(*Bfield_cp[lev][1],
-                        amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "By_cp"));
-            VisMF::Read(*Bfield_cp[lev][2],
-                        amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Bz_cp"));
+            RestartReader::Read(*Efield_cp[lev][0],
+                                amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Ex_cp"));
+            RestartReader::Read(*Efield_cp[lev][1],
+                                amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Ey_cp"));
+            RestartReader::Read(*Efield_cp[lev][2],
+                                amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Ez_cp"));
+
+            RestartReader::Read(*Bfield_cp[lev][0],
+                                amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Bx_cp"));
+            RestartReader::Read(*Bfield_cp[lev][1],
+                                amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "By_cp"));
+            RestartReader::Read(*Bfield_cp[lev][2],
+                                amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Bz_cp"));
 
 #ifdef WARPX_MAG_LLG
-            VisMF::Read(*Mfield_cp[lev][0],
-                        amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Mx_cp"));
-            VisMF::Read(*Mfield_cp[lev][1],
-                        amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "My_cp"));
-            VisMF::Read(*Mfield_cp[lev][2],
-                        amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Mz_cp"));
+            RestartReader::Read(*Hfield_cp[lev][0],
+                                amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Hx_cp"));
+            RestartReader::Read(*Hfield_cp[lev][1],
+                                amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Hy_cp"));
+            RestartReader::Read(*Hfield_cp[lev][2],
+                                amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Hz_cp"));
+
+            RestartReader::Read(*Mfield_cp[lev][0],
+                                amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Mx_cp"));
+            RestartReader::Read(*Mfield_cp[lev][1],
+                                amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "My_cp"));
+            RestartReader::Read(*Mfield_cp[lev][2],
+                                amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "Mz_cp"));
 #endif
 
             if (is_synchronized) {
-                VisMF::Read(*current_cp[lev][0],
-                            amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "jx_cp"));
-                VisMF::Read(*current_cp[lev][1],
-                            amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "jy_cp"));
-                VisMF::Read(*current_cp[lev][2],
-                            amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "jz_cp"));
+                RestartReader::Read(*current_cp[lev][0],
+                                    amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "jx_cp"));
+                RestartReader::Read(*current_cp[lev][1],
+                                    amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "jy_cp"));
+                RestartReader::Read(*current_cp[lev][2],
+                                    amrex::MultiFabFileFullPrefix(lev, restart_chkfile, level_prefix, "jz_cp"));
             }
         }
     }
@@ -287,42 +348,52 @@ WarpX::InitFromCheckpoint ()
 
 }
 
+void
+WarpX::InitStaticDataFromCheckpoint ()
+{
+    WARPX_PROFILE("WarpX::InitStaticDataFromCheckpoint()");
 
-std::unique_ptr<MultiFab>
-WarpX::GetCellCenteredData() {
-
-    WARPX_PROFILE("WarpX::GetCellCenteredData()");
-
-    const amrex::IntVect ng(1);
-    const int nc = 10;
+    // Checkpoints written by older versions do not have the time-invariant data
+    const std::string static_file = restart_chkfile + "/StaticData";
+    if (!amrex::FileExists(static_file)) return;
 
-    Vector<std::unique_ptr<MultiFab> > cc(finest_level+1);
+    Vector<char> fileCharPtr;
+    ParallelDescriptor::ReadAndBcastFile(static_file, fileCharPtr);
+    std::string static_path;
+    std::istringstream(std::string(fileCharPtr.dataPtr())) >> static_path;
+    const std::string static_dir = restart_chkfile + "/" + static_path;
 
-    for (int lev = 0; lev <= finest_level; ++lev)
+    // The time-invariant data may have been written with a different BoxArray
+    // (e.g., before load balancing), so it is redistributed to the new layout.
+    auto read_and_copy = [&static_dir] (MultiFab& mf, int lev, const std::string& name)
     {
-        cc[lev] = std::make_unique<MultiFab>(grids[lev], dmap[lev], nc, ng );
-
-        int dcomp = 0;
-        // first the electric field
-        AverageAndPackVectorField( *cc[lev], Efield_aux[lev], dmap[lev], dcomp, ng );
-        dcomp += 3;
-        // then the magnetic field
-        AverageAndPackVectorField( *cc[lev], Bfield_aux[lev], dmap[lev], dcomp, ng );
-        dcomp += 3;
-        // then the current density
-        AverageAndPackVectorField( *cc[lev], current_fp[lev], dmap[lev], dcomp, ng );
-        dcomp += 3;
-        // then the charge density
-        const std::unique_ptr<MultiFab>& charge_density = mypc->GetChargeDensity(lev);
-        AverageAndPackScalarField( *cc[lev], *charge_density, dmap[lev], dcomp, ng );
-
-        cc[lev]->FillBoundary(geom[lev].periodicity());
-    }
+        RestartReader::Read(mf, amrex::MultiFabFileFullPrefix(lev, static_dir, level_prefix, name));
+    };
 
-    for (int lev = finest_level; lev > 0; --lev)
-    {
-        CoarsenIO::Coarsen( *cc[lev-1], *cc[lev], 0, 0, nc, 0, refRatio(lev-1) );
+#ifdef WARPX_MAG_LLG
+    const std::array<std::string, 3> xyz {"x", "y", "z"};
+    for (int lev = 0; lev <= finestLevel(); ++lev) {
+        for (int i = 0; i < 3; ++i) {
+            read_and_copy(*H_biasfield_fp[lev][i], lev, "H_bias" + xyz[i] + "_fp");
+            if (lev > 0) {
+                read_and_copy(*H_biasfield_aux[lev][i], lev, "H_bias" + xyz[i] + "_aux");
+                read_and_copy(*H_biasfield_cp[lev][i], lev, "H_bias" + xyz[i] + "_cp");
+            }
+        }
     }
+#endif
 
-    return std::move(cc[0]);
+    // Overwrite the material properties initialized from the input parameters
+    if (em_solver_medium == MediumForEM::Macroscopic) {
+        read_and_copy(m_macroscopic_properties->getsigma_mf(), 0, "sigma");
+        read_and_copy(m_macroscopic_properties->getepsilon_mf(), 0, "epsilon");
+        read_and_copy(m_macroscopic_properties->getmu_mf(), 0, "mu");
+#ifdef WARPX_MAG_LLG
+        read_and_copy(m_macroscopic_properties->getmag_Ms_mf(), 0, "mag_Ms");
+        read_and_copy(m_macroscopic_properties->getmag_alpha_mf(), 0, "mag_alpha");
+        read_and_copy(m_macroscopic_properties->getmag_gamma_mf(), 0, "mag_gamma");
+        read_and_copy(m_macroscopic_properties->getmag_exchange_mf(), 0, "mag_exchange");
+        read_and_copy(m_macroscopic_properties->getmag_anisotropy_mf(), 0, "mag_anisotropy");
+#endif
+    }
 }
@@ -8,7 +8,9 @@
 
 #include "Diagnostics/ParticleDiag/ParticleDiag.H"
 #include "FieldIO.H"
+#include "Particles/Filter/FilterCompactParticles.H"
 #include "Particles/Filter/FilterFunctors.H"
+#include "Particles/PinnedMemoryParticleContainer.H"
 #include "Utils/RelativeCellPosition.H"
 #include "Utils/WarpXAlgorithmSelection.H"
 #include "Utils/WarpXProfilerWrapper.H"
@@ -16,13 +18,18 @@
 #include "WarpX.H"
 
 #include <AMReX.H>
+#include <AMReX_Arena.H>
 #include <AMReX_ArrayOfStructs.H>
 #include <AMReX_BLassert.H>
 #include <AMReX_Box.H>
 #include <AMReX_Config.H>
 #include <AMReX_FArrayBox.H>
 #include <AMReX_FabArray.H>
+#include <AMReX_GpuContainers.H>
+#include <AMReX_GpuDevice.H>
+#include <AMReX_GpuLaunch.H>
 #include <AMReX_GpuQualifiers.H>
+#include <AMReX_INT.H>
 #include <AMReX_IntVect.H>
 #include <AMReX_MFIter.H>
 #include <AMReX_MultiFab.H>
@@ -32,12 +39,15 @@
 #include <AMReX_Particle.H>
 #include <AMReX_Particles.H>
 #include <AMReX_Periodicity.H>
+#include <AMReX_Scan.H>
 #include <AMReX_StructOfArrays.H>
 
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <tuple>
@@ -296,11 +306,17 @@ WarpXOpenPMDPlot::WarpXOpenPMDPlot (
     std::string openPMDFileType,
     std::string operator_type,
     std::map< std::string, std::string > operator_parameters,
-    std::vector<bool> fieldPMLdirections)
+    std::vector<bool> fieldPMLdirections,
+    FieldCompression field_compression,
+    bool single_precision,
+    int particle_chunk_size)
   :m_Series(nullptr),
    m_Encoding(ie),
    m_OpenPMDFileType(std::move(openPMDFileType)),
-   m_fieldPMLdirections(std::move(fieldPMLdirections))
+   m_fieldPMLdirections(std::move(fieldPMLdirections)),
+   m_field_compression(std::move(field_compression)),
+   m_single_precision(single_precision),
+   m_particle_chunk_size(particle_chunk_size)
 {
   // pick first available backend if default is chosen
   if( m_OpenPMDFileType == "default" )
@@ -441,6 +457,281 @@ WarpXOpenPMDPlot::Init (openPMD::Access access, bool isBTD)
     m_Series->setSoftware( "WarpX", WarpX::Version() );
 }
 
+namespace
+{
+    /** Store a chunk of particle data from a staging buffer
+     *
+     * With openPMD-api spans, the data is copied into the buffer of the backend.
+     * Otherwise, the staging buffer must stay valid until the next flush of the series.
+     *
+     * @param[in] comp openPMD record component to write to
+     * @param[in] data staging buffer, of size n
+     * @param[in] offset offset of the chunk in the record component
+     * @param[in] n number of particles in the chunk
+     */
+    template <typename T>
+    void
+    StoreChunkFromBuffer (openPMD::RecordComponent comp, T const* data,
+                          uint64_t const offset, uint64_t const n)
+    {
+#if OPENPMDAPI_VERSION_GE(0, 14, 0)
+        auto view = comp.storeChunk<T>({offset}, {n});
+        auto span = view.currentBuffer();
+        std::copy(data, data + n, span.data());
+#else
+        comp.storeChunk(openPMD::shareRaw(data), {offset}, {n});
+#endif
+    }
+}
+
+void
+WarpXOpenPMDPlot::SetupSpeciesAttributes (openPMD::ParticleSpecies& currSpecies) const
+{
+  // meta data for ED-PIC extension
+  currSpecies.setAttribute( "particleShape", double( WarpX::noz ) );
+  // TODO allow this per direction in the openPMD standard, ED-PIC extension?
+  currSpecies.setAttribute( "particleShapes", [](){
+      return std::vector< double >{
+          double(WarpX::nox),
+#if AMREX_SPACEDIM==3
+          double(WarpX::noy),
+#endif
+          double(WarpX::noz)
+      };
+  }() );
+  currSpecies.setAttribute( "particlePush", [](){
+      switch( WarpX::particle_pusher_algo ) {
+          case ParticlePusherAlgo::Boris : return "Boris";
+          case ParticlePusherAlgo::Vay : return "Vay";
+          case ParticlePusherAlgo::HigueraCary : return "HigueraCary";
+          default: return "other";
+      }
+  }() );
+  currSpecies.setAttribute( "particleInterpolation", [](){
+      switch( WarpX::field_gathering_algo ) {
+          case GatheringAlgo::EnergyConserving : return "energyConserving";
+          case GatheringAlgo::MomentumConserving : return "momentumConserving";
+          default: return "other";
+      }
+  }() );
+  currSpecies.setAttribute( "particleSmoothing", "none" );
+  currSpecies.setAttribute( "currentDeposition", [](){
+      switch( WarpX::current_deposition_algo ) {
+          case CurrentDepositionAlgo::Esirkepov : return "Esirkepov";
+          case CurrentDepositionAlgo::Vay : return "Vay";
+          default: return "directMorseNielson";
+      }
+  }() );
+}
+
+template <typename Filter>
+void
+WarpXOpenPMDPlot::StreamToFile (WarpXParticleContainer* pc,
+                    const std::string& name,
+                    int iteration,
+                    const amrex::Vector<int>& write_real_comp,
+                    const amrex::Vector<int>& write_int_comp,
+                    const amrex::Vector<std::string>& real_comp_names,
+                    const amrex::Vector<std::string>&  int_comp_names,
+                    amrex::ParticleReal const charge,
+                    amrex::ParticleReal const mass,
+                    Filter const& filter,
+                    bool do_filter) const
+{
+  WARPX_PROFILE("WarpXOpenPMDPlot::StreamToFile()");
+
+  AMREX_ALWAYS_ASSERT_WITH_MESSAGE(m_Series != nullptr, "openPMD: series must be initialized");
+
+  int const nlevs = pc->finestLevel() + 1;
+
+  // Indices of the particles to write in each tile, only stored when filtering.
+  // This is the only per-particle temporary of the streaming output.
+  amrex::Vector<std::map<std::pair<int,int>, amrex::Gpu::DeviceVector<int>>> selected(nlevs);
+  amrex::Vector<long> numParticlesByLevel(nlevs, 0);
+  for (int lev = 0; lev < nlevs; ++lev) {
+      for (WarpXParIter pti(*pc, lev); pti.isValid(); ++pti) {
+          int const np = pti.numParticles();
+          if (!do_filter) {
+              numParticlesByLevel[lev] += np;
+              continue;
+          }
+          auto const src = pti.GetParticleTile().getConstParticleTileData();
+          amrex::Gpu::DeviceVector<int> mask(np);
+          amrex::Gpu::DeviceVector<int> position(np);
+          int* const p_mask = mask.dataPtr();
+          amrex::ParallelForRNG(np,
+              [=] AMREX_GPU_DEVICE (int ip, amrex::RandomEngine const& engine) noexcept
+          {
+              p_mask[ip] = filter(src, ip, engine) ? 1 : 0;
+          });
+          int const nselected = amrex::Scan::ExclusiveSum(np, p_mask, position.dataPtr());
+          auto& indices = selected[lev][std::make_pair(pti.index(), pti.LocalTileIndex())];
+          indices.resize(nselected);
+          int* const p_indices = indices.dataPtr();
+          int const* const p_position = position.dataPtr();
+          amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (int ip) noexcept
+          {
+              if (p_mask[ip]) p_indices[p_position[ip]] = ip;
+          });
+          amrex::Gpu::streamSynchronize();
+          numParticlesByLevel[lev] += nselected;
+      }
+  }
+
+  // Offsets are computed once for the whole species
+  WarpXParticleCounter counter(numParticlesByLevel);
+  openPMD::Iteration& currIteration = GetIteration(iteration);
+  openPMD::ParticleSpecies currSpecies = currIteration.particles[name];
+  SetupSpeciesAttributes(currSpecies);
+  SetupPos(currSpecies, counter.GetTotalNumParticles(), charge, mass);
+  SetupRealProperties(currSpecies, write_real_comp, real_comp_names, write_int_comp, int_comp_names,
+                      counter.GetTotalNumParticles());
+
+  // open files from all processors, in case some will not contribute below
+  m_Series->flush();
+
+  auto const getComponentRecord = [&currSpecies](std::string const comp_name) {
+    // handle scalar and non-scalar records by name
+    std::string record_name, component_name;
+    std::tie(record_name, component_name) = detail::name2openPMD(comp_name);
+    return currSpecies[record_name][component_name];
+  };
+  auto const positionComponents = detail::getParticlePositionComponentLabels();
+  int const npos = static_cast<int>(positionComponents.size());
+  amrex::Vector<int> real_out, int_out;
+  auto const real_counter = std::min(write_real_comp.size(), real_comp_names.size());
+  for (int idx = 0; idx < real_counter; ++idx) {
+      if (write_real_comp[m_NumAoSRealAttributes + idx]) real_out.push_back(idx);
+  }
+  auto const int_counter = std::min(write_int_comp.size(), int_comp_names.size());
+  for (int idx = 0; idx < int_counter; ++idx) {
+      if (write_int_comp[m_NumAoSIntAttributes + idx]) int_out.push_back(idx);
+  }
+
+  // Staging buffers for one chunk of all the written attributes, reused for all chunks
+  int const chunk_size = m_particle_chunk_size;
+  amrex::Gpu::PinnedVector<amrex::ParticleReal> real_buffer(
+      static_cast<std::size_t>(npos + real_out.size()) * chunk_size);
+  amrex::Gpu::PinnedVector<uint64_t> id_buffer(chunk_size);
+  amrex::Gpu::PinnedVector<int> int_buffer(static_cast<std::size_t>(int_out.size()) * chunk_size);
+
+  // With openPMD-api >= 0.14, each chunk is copied to a buffer owned by the backend (span),
+  // so that the staging buffers can be reused right away: the series is flushed once, after
+  // all the chunks. Otherwise, the backend reads the staging buffers at the next flush, so
+  // that the series is flushed after each chunk. With collective backends (parallel HDF5,
+  // ADIOS2 with MPI aggregation), the flush is collective: all ranks must flush the same
+  // number of times, so the ranks with fewer chunks flush once more for each missing chunk.
+#if OPENPMDAPI_VERSION_GE(0, 14, 0)
+  constexpr bool flush_each_chunk = false;
+#else
+  constexpr bool flush_each_chunk = true;
+#endif
+  int num_chunks = 0;
+  int max_num_chunks = 0;
+  if (flush_each_chunk) {
+      for (int lev = 0; lev < nlevs; ++lev) {
+          for (WarpXParIter pti(*pc, lev); pti.isValid(); ++pti) {
+              int const np_tile = do_filter ?
+                  static_cast<int>(selected[lev][std::make_pair(pti.index(), pti.LocalTileIndex())].size())
+                  : pti.numParticles();
+              num_chunks += (np_tile + chunk_size - 1) / chunk_size;
+          }
+      }
+      max_num_chunks = num_chunks;
+      amrex::ParallelDescriptor::ReduceIntMax(max_num_chunks);
+  }
+
+  for (int lev = 0; lev < nlevs; ++lev) {
+      uint64_t offset = static_cast<uint64_t>( counter.m_ParticleOffsetAtRank[lev] );
+
+      for (WarpXParIter pti(*pc, lev); pti.isValid(); ++pti) {
+          int const np_tile = do_filter ?
+              static_cast<int>(selected[lev][std::make_pair(pti.index(), pti.LocalTileIndex())].size())
+              : pti.numParticles();
+          int const* const p_indices = do_filter ?
+              selected[lev][std::make_pair(pti.index(), pti.LocalTileIndex())].dataPtr() : nullptr;
+          auto const* const pstruct = pti.GetArrayOfStructs()().dataPtr();
+          auto& soa = pti.GetStructOfArrays();
+
+          for (int start = 0; start < np_tile; start += chunk_size) {
+              int const n = std::min(chunk_size, np_tile - start);
+              uint64_t const n64 = static_cast<uint64_t>(n);
+
+              // Gather the chunk in the staging buffers
+              amrex::ParticleReal* const p_real = real_buffer.dataPtr();
+              uint64_t* const p_id = id_buffer.dataPtr();
+              for (int ipos = 0; ipos < npos; ++ipos) {
+                  amrex::ParticleReal* const dst = p_real + ipos * chunk_size;
+#if defined(WARPX_DIM_RZ)
+                  amrex::ParticleReal const* const theta = soa.GetRealData(PIdx::theta).dataPtr();
+#endif
+                  amrex::ParallelFor(n, [=] AMREX_GPU_DEVICE (int k) noexcept
+                  {
+                      int const ip = p_indices ? p_indices[start + k] : start + k;
+#if defined(WARPX_DIM_RZ)
+                      // reconstruct x and y from polar coordinates r, theta {0: "r", 1: "z"}
+                      amrex::ParticleReal const r = pstruct[ip].pos(0);
+                      if      (ipos == 0) dst[k] = r * std::cos(theta[ip]);
+                      else if (ipos == 1) dst[k] = r * std::sin(theta[ip]);
+                      else                dst[k] = pstruct[ip].pos(1);
+#else
+                      dst[k] = pstruct[ip].pos(ipos);
+#endif
+                  });
+              }
+              amrex::ParallelFor(n, [=] AMREX_GPU_DEVICE (int k) noexcept
+              {
+                  int const ip = p_indices ? p_indices[start + k] : start + k;
+                  p_id[k] = WarpXUtilIO::localIDtoGlobal( pstruct[ip].id(), pstruct[ip].cpu() );
+              });
+              for (int ir = 0; ir < real_out.size(); ++ir) {
+                  amrex::ParticleReal const* const src = soa.GetRealData(real_out[ir]).dataPtr();
+                  amrex::ParticleReal* const dst = p_real + (npos + ir) * chunk_size;
+                  amrex::ParallelFor(n, [=] AMREX_GPU_DEVICE (int k) noexcept
+                  {
+                      dst[k] = src[p_indices ? p_indices[start + k] : start + k];
+                  });
+              }
+              for (int ii = 0; ii < int_out.size(); ++ii) {
+                  int const* const src = soa.GetIntData(int_out[ii]).dataPtr();
+                  int* const dst = int_buffer.dataPtr() + ii * chunk_size;
+                  amrex::ParallelFor(n, [=] AMREX_GPU_DEVICE (int k) noexcept
+                  {
+                      dst[k] = src[p_indices ? p_indices[start + k] : start + k];
+                  });
+              }
+              amrex::Gpu::streamSynchronize();
+
+              for (int ipos = 0; ipos < npos; ++ipos) {
+                  StoreChunkFromBuffer(currSpecies["position"][positionComponents[ipos]],
+                                       p_real + ipos * chunk_size, offset, n64);
+              }
+              StoreChunkFromBuffer(currSpecies["id"][openPMD::RecordComponent::SCALAR],
+                                   p_id, offset, n64);
+              for (int ir = 0; ir < real_out.size(); ++ir) {
+                  StoreChunkFromBuffer(getComponentRecord(real_comp_names[m_NumAoSRealAttributes + real_out[ir]]),
+                                       p_real + (npos + ir) * chunk_size, offset, n64);
+              }
+              for (int ii = 0; ii < int_out.size(); ++ii) {
+                  StoreChunkFromBuffer(getComponentRecord(int_comp_names[m_NumAoSIntAttributes + int_out[ii]]),
+                                       int_buffer.dataPtr() + ii * chunk_size, offset, n64);
+              }
+              // the staging buffers are reused by the next chunk
+              if (flush_each_chunk) m_Series->flush();
+
+              offset += n64;
+          }
+      }
+  }
+  if (flush_each_chunk) {
+      for (int ichunk = num_chunks; ichunk < max_num_chunks; ++ichunk) {
+          m_Series->flush();
+      }
+  } else {
+      m_Series->flush();
+  }
+}
+
 void
 WarpXOpenPMDPlot::WriteOpenPMDParticles (const amrex::Vector<ParticleDiag>& particle_diags)
 {
@@ -448,7 +739,6 @@ WarpXOpenPMDPlot::WriteOpenPMDParticles (const amrex::Vector<ParticleDiag>& part
 
   for (unsigned i = 0, n = particle_diags.size(); i < n; ++i) {
     WarpXParticleContainer* pc = particle_diags[i].getParticleContainer();
-    ParticleContainer tmp(&WarpX::GetInstance());
     // names of amrex::Real and int particle attributes in SoA data
     amrex::Vector<std::string> real_names;
     amrex::Vector<std::string> int_names;
@@ -468,6 +758,25 @@ WarpXOpenPMDPlot::WriteOpenPMDParticles (const amrex::Vector<ParticleDiag>& part
     real_names.push_back("theta");
 #endif
 
+    // Particles already in host memory and in SI units, e.g., back-transformed particles,
+    // are written as they are. They only have the PIdx components.
+    PinnedMemoryParticleContainer* pinned_pc = particle_diags[i].getPinnedParticleContainer();
+    if (pinned_pc) {
+      real_flags = particle_diags[i].plot_flags;
+      real_flags.resize(PIdx::nattribs);
+      DumpToFile(pinned_pc,
+         particle_diags[i].getSpeciesName(),
+         m_CurrentStep,
+         real_flags,
+         int_flags,
+         real_names, int_names,
+         pc->getCharge(), pc->getMass()
+      );
+      continue;
+    }
+
+    ParticleContainer tmp(&WarpX::GetInstance());
+
     // add runtime real comps to tmp
     for (int ic = 0; ic < pc->NumRuntimeRealComps(); ++ic) { tmp.AddRealComp(false); }
 
@@ -499,31 +808,24 @@ WarpXOpenPMDPlot::WriteOpenPMDParticles (const amrex::Vector<ParticleDiag>& part
 
       pc->ConvertUnits(ConvertDirection::WarpX_to_SI);
 
-      RandomFilter const random_filter(particle_diags[i].m_do_random_filter,
-                                       particle_diags[i].m_random_fraction);
-      UniformFilter const uniform_filter(particle_diags[i].m_do_uniform_filter,
-                                         particle_diags[i].m_uniform_stride);
-      ParserFilter parser_filter(particle_diags[i].m_do_parser_filter,
-                                 compileParser<ParticleDiag::m_nvars>
-                                     (particle_diags[i].m_particle_filter_parser.get()),
-                                 pc->getMass());
-      parser_filter.m_units = InputUnits::SI;
-      GeometryFilter const geometry_filter(particle_diags[i].m_do_geom_filter,
-                                           particle_diags[i].m_diag_domain);
-
-      using SrcData = WarpXParticleContainer::ParticleTileType::ConstParticleTileDataType;
-      tmp.copyParticles(*pc,
-                        [=] AMREX_GPU_HOST_DEVICE (const SrcData& src, int ip, const amrex::RandomEngine& engine)
-      {
-          const SuperParticleType& p = src.getSuperParticle(ip);
-          return random_filter(p, engine) * uniform_filter(p, engine)
-                 * parser_filter(p, engine) * geometry_filter(p, engine);
-      }, true);
+      auto const filter = particle_diags[i].GetFilter();
 
     // real_names contains a list of all real particle attributes.
     // real_flags is 1 or 0, whether quantity is dumped or not.
 
-    {
+    if (m_particle_chunk_size > 0) {
+      StreamToFile(pc,
+         particle_diags[i].getSpeciesName(),
+         m_CurrentStep,
+         real_flags,
+         int_flags,
+         real_names, int_names,
+         pc->getCharge(), pc->getMass(),
+         filter, particle_diags[i].DoFilter()
+      );
+    } else {
+      // Only the selected particles are copied to the host
+      filterAndCompactParticles(tmp, *pc, filter);
       DumpToFile(&tmp,
          particle_diags[i].getSpeciesName(),
          m_CurrentStep,
@@ -556,41 +858,7 @@ WarpXOpenPMDPlot::DumpToFile (ParticleContainer* pc,
   openPMD::Iteration& currIteration = GetIteration(iteration);
 
   openPMD::ParticleSpecies currSpecies = currIteration.particles[name];
-  // meta data for ED-PIC extension
-  currSpecies.setAttribute( "particleShape", double( WarpX::noz ) );
-  // TODO allow this per direction in the openPMD standard, ED-PIC extension?
-  currSpecies.setAttribute( "particleShapes", [](){
-      return std::vector< double >{
-          double(WarpX::nox),
-#if AMREX_SPACEDIM==3
-          double(WarpX::noy),
-#endif
-          double(WarpX::noz)
-      };
-  }() );
-  currSpecies.setAttribute( "particlePush", [](){
-      switch( WarpX::particle_pusher_algo ) {
-          case ParticlePusherAlgo::Boris : return "Boris";
-          case ParticlePusherAlgo::Vay : return "Vay";
-          case ParticlePusherAlgo::HigueraCary : return "HigueraCary";
-          default: return "other";
-      }
-  }() );
-  currSpecies.setAttribute( "particleInterpolation", [](){
-      switch( WarpX::field_gathering_algo ) {
-          case GatheringAlgo::EnergyConserving : return "energyConserving";
-          case GatheringAlgo::MomentumConserving : return "momentumConserving";
-          default: return "other";
-      }
-  }() );
-  currSpecies.setAttribute( "particleSmoothing", "none" );
-  currSpecies.setAttribute( "currentDeposition", [](){
-      switch( WarpX::current_deposition_algo ) {
-          case CurrentDepositionAlgo::Esirkepov : return "Esirkepov";
-          case CurrentDepositionAlgo::Vay : return "Vay";
-          default: return "directMorseNielson";
-      }
-  }() );
+  SetupSpeciesAttributes(currSpecies);
 
   //
   // define positions & offsets
@@ -971,11 +1239,13 @@ WarpXOpenPMDPlot::SetupFields(  openPMD::Container< openPMD::Mesh >& meshes,
  * @param [IN]: mesh          a mesh field
  * @param [IN]: full_geom     geometry for the mesh
  * @param [IN]: mesh_comp     a component for the mesh
+ * @param [IN]: varname       WarpX name of the field
  */
 void
 WarpXOpenPMDPlot::SetupMeshComp( openPMD::Mesh& mesh,
                                  amrex::Geometry& full_geom,
-                                 openPMD::MeshRecordComponent& mesh_comp ) const
+                                 openPMD::MeshRecordComponent& mesh_comp,
+                                 const std::string& varname ) const
 {
        amrex::Box const & global_box = full_geom.Domain();
        auto const global_size = getReversedVec(global_box.size());
@@ -987,8 +1257,16 @@ WarpXOpenPMDPlot::SetupMeshComp( openPMD::Mesh& mesh,
        std::vector<std::string> axis_labels = detail::getFieldAxisLabels();
 
        // Prepare the type of dataset that will be written
-       openPMD::Datatype const datatype = openPMD::determineDatatype<amrex::Real>();
+       openPMD::Datatype const datatype = m_single_precision ?
+           openPMD::determineDatatype<float>() : openPMD::determineDatatype<amrex::Real>();
+#if OPENPMDAPI_VERSION_GE(0, 14, 0)
+       // per-field backend compression, see FieldCompression
+       auto const dataset = openPMD::Dataset(datatype, global_size,
+                                             m_field_compression.OpenPMDDatasetOptions(varname));
+#else
+       amrex::ignore_unused(varname);
        auto const dataset = openPMD::Dataset(datatype, global_size);
+#endif
 
        mesh.setDataOrder(openPMD::Mesh::DataOrder::C);
        mesh.setAxisLabels(axis_labels);
@@ -1095,7 +1373,7 @@ WarpXOpenPMDPlot::WriteOpenPMDFieldsAll ( //const std::string& filename,
           auto mesh_comp = mesh[comp_name];
           if ( first_write_to_iteration )
           {
-             SetupMeshComp( mesh, full_geom, mesh_comp );
+             SetupMeshComp( mesh, full_geom, mesh_comp, varname );
              detail::setOpenPMDUnit( mesh, field_name );
 
              auto relative_cell_pos = utils::getRelativeCellPosition(mf[i]);     // AMReX Fortran index order
@@ -1116,10 +1394,26 @@ WarpXOpenPMDPlot::WriteOpenPMDFieldsAll ( //const std::string& filename,
                 auto const chunk_size = getReversedVec( local_box.size() );
 
                 amrex::Real const * local_data = fab.dataPtr( icomp );
-                mesh_comp.storeChunk( openPMD::shareRaw(local_data),
-                                      chunk_offset, chunk_size );
+                if ( m_single_precision ) {
+                    // Convert to float in a pinned buffer that openPMD-api owns until
+                    // the data is flushed. Same memory layout as the FAB component.
+                    auto const npts = local_box.numPts();
+                    float * const AMREX_RESTRICT single_data = static_cast<float*>(
+                        amrex::The_Pinned_Arena()->alloc(npts*sizeof(float)) );
+                    amrex::ParallelFor( npts, [=] AMREX_GPU_DEVICE (amrex::Long idx) {
+                        single_data[idx] = static_cast<float>(local_data[idx]);
+                    });
+                    std::shared_ptr<float> const single_chunk( single_data,
+                        [](float * p){ amrex::The_Pinned_Arena()->free(p); } );
+                    mesh_comp.storeChunk( single_chunk, chunk_offset, chunk_size );
+                } else {
+                    mesh_comp.storeChunk( openPMD::shareRaw(local_data),
+                                          chunk_offset, chunk_size );
+                }
             }
     } // icomp loop
+    // Conversion kernels must be done before openPMD-api reads the buffers
+    if ( m_single_precision ) amrex::Gpu::streamSynchronize();
     // Flush data to disk after looping over all components
     m_Series->flush();
   } // levels loop (i)
@@ -1133,21 +1427,36 @@ WarpXOpenPMDPlot::WriteOpenPMDFieldsAll ( //const std::string& filename,
 //
 WarpXParticleCounter::WarpXParticleCounter(ParticleContainer* pc)
 {
-  m_MPISize = amrex::ParallelDescriptor::NProcs();
-  m_MPIRank = amrex::ParallelDescriptor::MyProc();
-
-  m_ParticleCounterByLevel.resize(pc->finestLevel()+1);
-  m_ParticleOffsetAtRank.resize(pc->finestLevel()+1);
-  m_ParticleSizeAtRank.resize(pc->finestLevel()+1);
-
+  amrex::Vector<long> numParticlesByLevel(pc->finestLevel()+1, 0);
   for (auto currentLevel = 0; currentLevel <= pc->finestLevel(); currentLevel++)
     {
-      long numParticles = 0; // numParticles in this processor
-
       for (ParticleIter pti(*pc, currentLevel); pti.isValid(); ++pti) {
           auto numParticleOnTile = pti.numParticles();
-          numParticles += numParticleOnTile;
+          numParticlesByLevel[currentLevel] += numParticleOnTile;
       }
+    }
+  ComputeOffsets(numParticlesByLevel);
+}
+
+WarpXParticleCounter::WarpXParticleCounter(const amrex::Vector<long>& numParticlesByLevel)
+{
+  ComputeOffsets(numParticlesByLevel);
+}
+
+void
+WarpXParticleCounter::ComputeOffsets(const amrex::Vector<long>& numParticlesByLevel)
+{
+  m_MPISize = amrex::ParallelDescriptor::NProcs();
+  m_MPIRank = amrex::ParallelDescriptor::MyProc();
+
+  auto const nlevs = numParticlesByLevel.size();
+  m_ParticleCounterByLevel.resize(nlevs);
+  m_ParticleOffsetAtRank.resize(nlevs);
+  m_ParticleSizeAtRank.resize(nlevs);
+
+  for (auto currentLevel = 0; currentLevel < nlevs; currentLevel++)
+    {
+      long const numParticles = numParticlesByLevel[currentLevel]; // numParticles in this processor
 
       unsigned long long offset=0; // offset of this level
       unsigned long long sum=0; // numParticles in this level (sum from all processors)
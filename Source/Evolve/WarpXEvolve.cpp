@@ -10,7 +10,6 @@
  */
 #include "WarpX.H"
 
-#include "Diagnostics/BackTransformedDiagnostic.H"
 #include "Diagnostics/MultiDiagnostics.H"
 #include "Diagnostics/ReducedDiags/MultiReducedDiags.H"
 #include "Evolve/WarpXDtType.H"
@@ -249,12 +248,11 @@ WarpX::Evolve (int numsteps)
 
         ShiftGalileanBoundary();
 
-        if (do_back_transformed_diagnostics) {
-            std::unique_ptr<MultiFab> cell_centered_data = nullptr;
-            if (WarpX::do_back_transformed_fields) {
-                cell_centered_data = GetCellCenteredData();
-            }
-            myBFD->writeLabFrameData(cell_centered_data.get(), *mypc, geom[0], cur_time, dt[0]);
+        if (do_back_transformed_particles) {
+            // Particles crossing the lab-frame snapshots must be collected before they are
+            // redistributed, while the data saved during the push is still valid.
+            // The fields are back-transformed with the other diagnostics at the end of the step.
+            multi_diags->BackTransformParticles(cur_time, dt[0]);
         }
 
         bool move_j = is_synchronized;
@@ -296,10 +294,7 @@ WarpX::Evolve (int numsteps)
         AMREX_ALWAYS_ASSERT(maxLevel() == 0);
         mypc->ScrapeParticles(amrex::GetVecOfConstPtrs(m_distance_to_eb));
 #endif
-        if (sort_intervals.contains(step+1)) {
-            amrex::Print() << "re-sorting particles \n";
-            mypc->SortParticlesByBin(sort_bin_size);
-        }
+        mypc->SortParticles(step+1);
 
         if( do_electrostatic != ElectrostaticSolverAlgo::None ) {
             // Electrostatic solver:
@@ -352,10 +347,6 @@ WarpX::Evolve (int numsteps)
     }
 
     multi_diags->FilterComputePackFlushLastTimestep( istep[0] );
-
-    if (do_back_transformed_diagnostics) {
-        myBFD->Flush(geom[0]);
-    }
 }
 
 /* /brief Perform one PIC iteration, without subcycling
@@ -247,7 +247,7 @@ guardCellManager::Init (
         }
     } else {
         // Compute number of cells required for Field Gather
-        int FGcell[4] = {0,1,1,2}; // Index is nox
+        int FGcell[6] = {0,1,1,2,2,3}; // Index is nox
         IntVect ng_FieldGather_noNCI = IntVect(AMREX_D_DECL(FGcell[nox],FGcell[nox],FGcell[nox]));
         ng_FieldGather_noNCI = ng_FieldGather_noNCI.min(ng_alloc_EB);
         // If NCI filter, add guard cells in the z direction
@@ -23,12 +23,14 @@
 #ifdef WARPX_QED
 #   include "Particles/ParticleCreation/FilterCreateTransformFromFAB.H"
 #endif
+#include "Particles/ParticleCreation/ParticleTileCapacity.H"
 #include "Particles/ParticleCreation/SmartCopy.H"
 #include "Particles/ParticleCreation/SmartCreate.H"
 #include "Particles/ParticleCreation/SmartUtils.H"
 #include "Particles/PhotonParticleContainer.H"
 #include "Particles/PhysicalParticleContainer.H"
 #include "Particles/RigidInjectedParticleContainer.H"
+#include "Particles/Sorting/SortingPolicy.H"
 #include "Particles/WarpXParticleContainer.H"
 #include "SpeciesPhysicalProperties.H"
 #include "Utils/WarpXAlgorithmSelection.H"
@@ -139,6 +141,8 @@ MultiParticleContainer::ReadParameters ()
     {
         ParmParse pp_particles("particles");
 
+        ParticleTileCapacity::ReadParameters();
+
         // allocating and initializing default values of external fields for particles
         m_E_external_particle.resize(3);
         m_B_external_particle.resize(3);
@@ -418,9 +422,22 @@ MultiParticleContainer::Evolve (int lev,
         if (rho) rho->setVal(0.0);
         if (crho) crho->setVal(0.0);
     }
+    const int step = WarpX::GetInstance().getistep(lev);
     for (auto& pc : allcontainers) {
+        // Time spent by each species, for the adaptive sorting policy
+        const bool time_species = pc->getSortingPolicy().isTimedStep(step);
+        Real wt = 0._rt;
+        if (time_species) {
+            amrex::Gpu::synchronize();
+            wt = amrex::second();
+        }
         pc->Evolve(lev, Ex, Ey, Ez, Bx, By, Bz, jx, jy, jz, cjx, cjy, cjz,
                    rho, crho, cEx, cEy, cEz, cBx, cBy, cBz, t, dt, a_dt_type, skip_deposition);
+        if (time_species) {
+            amrex::Gpu::synchronize();
+            pc->getSortingPolicy().addEvolveTime(amrex::second() - wt,
+                                                 pc->TotalNumberOfParticles(true, true));
+        }
     }
 }
 
@@ -554,11 +571,30 @@ MultiParticleContainer::SortParticlesByBin (amrex::IntVect bin_size)
     }
 }
 
+void
+MultiParticleContainer::SortParticles (const int step)
+{
+    bool resorted = false;
+    for (auto& pc : allcontainers) {
+        SortingPolicy& policy = pc->getSortingPolicy();
+        if (policy.shouldSort(step, *pc)) {
+            resorted = true;
+            amrex::Gpu::synchronize();
+            const Real wt = amrex::second();
+            pc->SortParticlesByBin(policy.binSize());
+            amrex::Gpu::synchronize();
+            policy.sorted(amrex::second() - wt);
+        }
+    }
+    // With the adaptive policy, the decision is local to each MPI rank
+    if (resorted) amrex::Print() << "re-sorting particles \n";
+}
+
 void
 MultiParticleContainer::Redistribute ()
 {
     for (auto& pc : allcontainers) {
-        pc->Redistribute();
+        ParticleTileCapacity::Redistribute(*pc);
     }
 }
 
@@ -574,7 +610,7 @@ void
 MultiParticleContainer::RedistributeLocal (const int num_ghost)
 {
     for (auto& pc : allcontainers) {
-        pc->Redistribute(0, 0, 0, num_ghost);
+        ParticleTileCapacity::Redistribute(*pc, 0, 0, 0, num_ghost);
     }
 }
 
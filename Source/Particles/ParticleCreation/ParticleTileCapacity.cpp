@@ -0,0 +1,110 @@
+/* Copyright 2026 The WarpX Community
+ *
+ * This file is part of WarpX.
+ *
+ * License: BSD-3-Clause-LBNL
+ */
+#include "ParticleTileCapacity.H"
+
+#include "Particles/WarpXParticleContainer.H"
+#include "Utils/WarpXUtil.H"
+
+#include <AMReX.H>
+#include <AMReX_ParmParse.H>
+
+#include <map>
+#include <tuple>
+#include <utility>
+
+using namespace amrex::literals;
+
+amrex::Real ParticleTileCapacity::growth_factor = 1.5_rt;
+amrex::Real ParticleTileCapacity::headroom = 0.1_rt;
+amrex::Real ParticleTileCapacity::shrink_factor = 4._rt;
+amrex::Long ParticleTileCapacity::m_num_reallocations = 0;
+amrex::Long ParticleTileCapacity::m_bytes_moved = 0;
+
+void
+ParticleTileCapacity::ReadParameters ()
+{
+    amrex::ParmParse pp_particles("particles");
+    queryWithParser(pp_particles, "tile_growth_factor", growth_factor);
+    queryWithParser(pp_particles, "tile_headroom", headroom);
+    queryWithParser(pp_particles, "tile_shrink_factor", shrink_factor);
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(growth_factor >= 1._rt,
+        "particles.tile_growth_factor must be at least 1");
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(headroom >= 0._rt,
+        "particles.tile_headroom must be non-negative");
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(shrink_factor > growth_factor*(1._rt + headroom),
+        "particles.tile_shrink_factor must be larger than "
+        "particles.tile_growth_factor*(1 + particles.tile_headroom)");
+}
+
+void
+ParticleTileCapacity::Redistribute (WarpXParticleContainer& pc, int lev_min, int lev_max,
+                                    int nGrow, int local)
+{
+    const bool manage_capacity = (growth_factor > 1._rt);
+
+    // Data pointer and number of particles of each tile before the redistribution
+    std::map<std::tuple<int,int,int>, std::pair<const void*, std::size_t>> tiles_before;
+    auto& particles = pc.GetParticles();
+    for (int lev = 0; lev < static_cast<int>(particles.size()); ++lev) {
+        for (auto& kv : particles[lev]) {
+            auto& tile = kv.second;
+            const std::size_t np = tile.numParticles();
+            if (manage_capacity && np > 0) {
+                const amrex::Real min_capacity = (1._rt + headroom)*static_cast<amrex::Real>(np);
+                if (static_cast<amrex::Real>(tile.GetArrayOfStructs()().capacity()) < min_capacity) {
+                    reserve(tile, static_cast<std::size_t>(growth_factor*min_capacity));
+                }
+            }
+            tiles_before[std::make_tuple(lev, kv.first.first, kv.first.second)] =
+                std::make_pair(tile.GetArrayOfStructs()().dataPtr(), np);
+        }
+    }
+
+    pc.Redistribute(lev_min, lev_max, nGrow, local);
+
+    for (int lev = 0; lev < static_cast<int>(particles.size()); ++lev) {
+        for (auto& kv : particles[lev]) {
+            auto& tile = kv.second;
+            auto& aos = tile.GetArrayOfStructs()();
+
+            // Count the reallocations done by Redistribute
+            const auto it = tiles_before.find(std::make_tuple(lev, kv.first.first, kv.first.second));
+            if (it != tiles_before.end() && it->second.second > 0 &&
+                it->second.first != aos.dataPtr()) {
+                addReallocation(it->second.second*bytesPerParticle(tile));
+            }
+
+            // Release the capacity of the tiles that are much larger than needed
+            const std::size_t np = tile.numParticles();
+            if (manage_capacity && static_cast<amrex::Real>(aos.capacity()) >
+                shrink_factor*static_cast<amrex::Real>(np)) {
+                aos.shrink_to_fit();
+                auto& soa = tile.GetStructOfArrays();
+                for (int i = 0; i < soa.NumRealComps(); ++i) {
+                    soa.GetRealData(i).shrink_to_fit();
+                }
+                for (int i = 0; i < soa.NumIntComps(); ++i) {
+                    soa.GetIntData(i).shrink_to_fit();
+                }
+                if (np > 0) addReallocation(np*bytesPerParticle(tile));
+            }
+        }
+    }
+}
+
+void
+ParticleTileCapacity::addReallocation (const std::size_t bytes)
+{
+#ifdef AMREX_USE_OMP
+#pragma omp atomic
+#endif
+    m_num_reallocations += 1;
+#ifdef AMREX_USE_OMP
+#pragma omp atomic
+#endif
+    m_bytes_moved += static_cast<amrex::Long>(bytes);
+}
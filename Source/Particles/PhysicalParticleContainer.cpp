@@ -15,18 +15,22 @@
 #include "Initialization/InjectorMomentum.H"
 #include "Initialization/InjectorPosition.H"
 #include "MultiParticleContainer.H"
+#include "Particles/Deposition/CurrentDeposition.H"
 #ifdef WARPX_QED
 #   include "Particles/ElementaryProcess/QEDInternals/BreitWheelerEngineWrapper.H"
 #   include "Particles/ElementaryProcess/QEDInternals/QuantumSyncEngineWrapper.H"
 #endif
 #include "Particles/Gather/FieldGather.H"
+#include "Particles/Gather/FieldGatherSIMD.H"
 #include "Particles/Gather/GetExternalFields.H"
+#include "Particles/ParticleCreation/ParticleTileCapacity.H"
 #include "Particles/Pusher/CopyParticleAttribs.H"
 #include "Particles/Pusher/GetAndSetPosition.H"
 #include "Particles/Pusher/PushSelector.H"
 #include "Particles/Pusher/UpdateMomentumBoris.H"
 #include "Particles/Pusher/UpdateMomentumBorisWithRadiationReaction.H"
 #include "Particles/Pusher/UpdateMomentumHigueraCary.H"
+#include "Particles/Pusher/UpdateMomentumSIMD.H"
 #include "Particles/Pusher/UpdateMomentumVay.H"
 #include "Particles/Pusher/UpdatePosition.H"
 #include "Particles/SpeciesPhysicalProperties.H"
@@ -36,6 +40,7 @@
 #include "Utils/WarpXAlgorithmSelection.H"
 #include "Utils/WarpXConst.H"
 #include "Utils/WarpXProfilerWrapper.H"
+#include "Utils/WarpXSIMD.H"
 #include "Utils/WarpXUtil.H"
 #include "WarpX.H"
 
@@ -74,6 +79,7 @@
 #include <AMReX_Particle.H>
 #include <AMReX_ParticleContainerBase.H>
 #include <AMReX_ParticleTile.H>
+#include <AMReX_ParticleUtil.H>
 #include <AMReX_Print.H>
 #include <AMReX_Random.H>
 #include <AMReX_SPACE.H>
@@ -107,6 +113,41 @@ using namespace amrex;
 
 namespace
 {
+    /** Used by PushPXImpl when the current is deposited in a separate loop over the particles */
+    struct NoCurrentDeposition
+    {
+        static constexpr bool deposits = false;
+
+        AMREX_GPU_HOST_DEVICE AMREX_FORCE_INLINE
+        void operator() (const long /*ip*/) const noexcept {}
+    };
+
+    /** Used by PushPXImpl to deposit the current of each particle right after its push */
+    template <typename Depositor>
+    struct FusedCurrentDeposition
+    {
+        static constexpr bool deposits = true;
+
+        Depositor m_depositor;
+        Array4<Real> m_jx_arr;
+        Array4<Real> m_jy_arr;
+        Array4<Real> m_jz_arr;
+
+        AMREX_GPU_HOST_DEVICE AMREX_FORCE_INLINE
+        void operator() (const long ip) const noexcept
+        {
+            m_depositor(ip, m_jx_arr, m_jy_arr, m_jz_arr);
+        }
+    };
+
+    template <typename Depositor>
+    FusedCurrentDeposition<Depositor>
+    makeFusedCurrentDeposition (const Depositor& depositor, Array4<Real> const& jx_arr,
+                                Array4<Real> const& jy_arr, Array4<Real> const& jz_arr)
+    {
+        return FusedCurrentDeposition<Depositor>{depositor, jx_arr, jy_arr, jz_arr};
+    }
+
     // Since the user provides the density distribution
     // at t_lab=0 and in the lab-frame coordinates,
     // we need to find the lab-frame position of this
@@ -182,6 +223,8 @@ PhysicalParticleContainer::PhysicalParticleContainer (AmrCore* amr_core, int isp
     pp_species_name.query("do_not_gather", do_not_gather);
     pp_species_name.query("do_not_push", do_not_push);
 
+    m_sorting_policy = SortingPolicy(species_name);
+
     pp_species_name.query("do_continuous_injection", do_continuous_injection);
     pp_species_name.query("initialize_self_fields", initialize_self_fields);
     queryWithParser(pp_species_name, "self_fields_required_precision", self_fields_required_precision);
@@ -794,7 +837,7 @@ PhysicalParticleContainer::AddPlasma (int lev, RealBox part_realbox)
 
         auto old_size = particle_tile.GetArrayOfStructs().size();
         auto new_size = old_size + max_new_particles;
-        particle_tile.resize(new_size);
+        ParticleTileCapacity::resize(particle_tile, new_size);
 
         ParticleType* pp = particle_tile.GetArrayOfStructs()().data() + old_size;
         auto& soa = particle_tile.GetStructOfArrays();
@@ -1212,7 +1255,7 @@ PhysicalParticleContainer::AddPlasmaFlux (int lev, amrex::Real dt)
 
         auto old_size = particle_tile.GetArrayOfStructs().size();
         auto new_size = old_size + max_new_particles;
-        particle_tile.resize(new_size);
+        ParticleTileCapacity::resize(particle_tile, new_size);
 
         ParticleType* pp = particle_tile.GetArrayOfStructs()().data() + old_size;
         auto& soa = particle_tile.GetStructOfArrays();
@@ -1425,7 +1468,19 @@ PhysicalParticleContainer::Evolve (int lev,
 
     bool has_buffer = cEx || cjx;
 
-    if (WarpX::do_back_transformed_diagnostics && do_back_transformed_diagnostics)
+    // Gather, push and deposit the current in a single loop over the particles,
+    // when no other operation needs to happen between the push and the deposition
+    bool fuse_push_and_deposition = WarpX::do_fused_push_and_deposition &&
+        canFusePushAndDeposition() && !has_buffer && !do_not_push &&
+        !skip_deposition && !do_not_deposit &&
+        !WarpX::do_blocked_current_deposition &&
+        WarpX::current_deposition_algo != CurrentDepositionAlgo::Vay &&
+        !(WarpX::do_back_transformed_particles && do_back_transformed_diagnostics);
+#ifdef WARPX_QED
+    fuse_push_and_deposition = fuse_push_and_deposition && !has_quantum_sync();
+#endif
+
+    if (WarpX::do_back_transformed_particles && do_back_transformed_diagnostics)
     {
         for (WarpXParIter pti(*this, lev); pti.isValid(); ++pti)
         {
@@ -1528,7 +1583,15 @@ PhysicalParticleContainer::Evolve (int lev,
                 }
             }
 
-            if (! do_not_push)
+            if (fuse_push_and_deposition)
+            {
+                WARPX_PROFILE_VAR_START(blp_fg);
+                PushPXAndDepositCurrent(pti, exfab, eyfab, ezfab, bxfab, byfab, bzfab,
+                                        Ex.nGrowVect(), lev, dt, a_dt_type,
+                                        &jx, &jy, &jz, thread_num);
+                WARPX_PROFILE_VAR_STOP(blp_fg);
+            }
+            else if (! do_not_push)
             {
                 const long np_gather = (cEx) ? nfine_gather : np;
 
@@ -2240,6 +2303,224 @@ PhysicalParticleContainer::PushPX (WarpXParIter& pti,
                                    int lev, int gather_lev,
                                    amrex::Real dt, ScaleFields scaleFields,
                                    DtType a_dt_type)
+{
+    PushPXImpl(pti, exfab, eyfab, ezfab, bxfab, byfab, bzfab, ngE, offset, np_to_push,
+               lev, gather_lev, dt, scaleFields, a_dt_type, NoCurrentDeposition{});
+}
+
+void
+PhysicalParticleContainer::PushPXAndDepositCurrent (WarpXParIter& pti,
+                                                    amrex::FArrayBox const * exfab,
+                                                    amrex::FArrayBox const * eyfab,
+                                                    amrex::FArrayBox const * ezfab,
+                                                    amrex::FArrayBox const * bxfab,
+                                                    amrex::FArrayBox const * byfab,
+                                                    amrex::FArrayBox const * bzfab,
+                                                    const amrex::IntVect ngE,
+                                                    int lev, amrex::Real dt, DtType a_dt_type,
+                                                    amrex::MultiFab * const jx,
+                                                    amrex::MultiFab * const jy,
+                                                    amrex::MultiFab * const jz,
+                                                    int thread_num)
+{
+    const long np = pti.numParticles();
+    if (np == 0) return;
+
+    WarpX& warpx = WarpX::GetInstance();
+    const amrex::IntVect& ng_J = warpx.get_ng_depos_J();
+    const std::array<Real,3>& dx = WarpX::CellSize(lev);
+
+    // The positions are checked before the push: the range available for the shape
+    // of the particles is reduced by the distance that they can travel in one step
+#if   (AMREX_SPACEDIM == 2)
+    const amrex::IntVect shape_extent = amrex::IntVect(static_cast<int>(WarpX::nox/2),
+                                                       static_cast<int>(WarpX::noz/2));
+    const amrex::IntVect max_displacement = amrex::IntVect(
+        static_cast<int>(std::ceil(PhysConst::c*dt/dx[0])),
+        static_cast<int>(std::ceil(PhysConst::c*dt/dx[2])));
+#elif (AMREX_SPACEDIM == 3)
+    const amrex::IntVect shape_extent = amrex::IntVect(static_cast<int>(WarpX::nox/2),
+                                                       static_cast<int>(WarpX::noy/2),
+                                                       static_cast<int>(WarpX::noz/2));
+    const amrex::IntVect max_displacement = amrex::IntVect(
+        static_cast<int>(std::ceil(PhysConst::c*dt/dx[0])),
+        static_cast<int>(std::ceil(PhysConst::c*dt/dx[1])),
+        static_cast<int>(std::ceil(PhysConst::c*dt/dx[2])));
+#endif
+#ifndef AMREX_USE_GPU
+    const amrex::IntVect range = ng_J - shape_extent - max_displacement;
+#else
+    const amrex::IntVect range = jx->nGrowVect() - shape_extent - max_displacement;
+#endif
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
+        amrex::numParticlesOutOfRange(pti, range) == 0,
+        "Particles shape does not fit within tile (CPU) or guard cells (GPU) used for current deposition");
+
+    if (WarpX::current_deposition_algo == CurrentDepositionAlgo::Esirkepov) {
+        if (WarpX::do_nodal==1) {
+          amrex::Abort("The Esirkepov algorithm cannot be used with a nodal grid.");
+        }
+        if ( (m_v_galilean[0]!=0) or (m_v_galilean[1]!=0) or (m_v_galilean[2]!=0)){
+            amrex::Abort("The Esirkepov algorithm cannot be used with the Galilean algorithm.");
+        }
+    }
+
+    // Same deposition target as in DepositCurrent
+    Box tilebox = pti.tilebox();
+#ifndef AMREX_USE_GPU
+    Box tbx = convert( tilebox, jx->ixType().toIntVect() );
+    Box tby = convert( tilebox, jy->ixType().toIntVect() );
+    Box tbz = convert( tilebox, jz->ixType().toIntVect() );
+    tbx.grow(ng_J);
+    tby.grow(ng_J);
+    tbz.grow(ng_J);
+#endif
+    tilebox.grow(ng_J);
+
+#ifdef AMREX_USE_GPU
+    amrex::ignore_unused(thread_num);
+    auto & jx_fab = jx->get(pti);
+    auto & jy_fab = jy->get(pti);
+    auto & jz_fab = jz->get(pti);
+#else
+    local_jx[thread_num].resize(tbx, jx->nComp());
+    local_jy[thread_num].resize(tby, jy->nComp());
+    local_jz[thread_num].resize(tbz, jz->nComp());
+    local_jx[thread_num].setVal(0.0);
+    local_jy[thread_num].setVal(0.0);
+    local_jz[thread_num].setVal(0.0);
+    auto & jx_fab = local_jx[thread_num];
+    auto & jy_fab = local_jy[thread_num];
+    auto & jz_fab = local_jz[thread_num];
+#endif
+    Array4<Real> const& jx_arr = jx_fab.array();
+    Array4<Real> const& jy_arr = jy_fab.array();
+    Array4<Real> const& jz_arr = jz_fab.array();
+
+    const Dim3 lo = lbound(tilebox);
+    // The current is deposited at t_{n+1/2}: take into account the Galilean shift at that time
+    Real cur_time = warpx.gett_new(lev);
+    Real time_shift = (cur_time + 0.5_rt*dt - warpx.time_of_last_gal_shift);
+    amrex::Array<amrex::Real,3> galilean_shift = {
+        m_v_galilean[0]*time_shift,
+        m_v_galilean[1]*time_shift,
+        m_v_galilean[2]*time_shift };
+    const std::array<Real, 3>& xyzmin = WarpX::LowerCorner(tilebox, galilean_shift, lev);
+
+    auto& attribs = pti.GetAttribs();
+    const ParticleReal* const wp = attribs[PIdx::w].dataPtr();
+    const ParticleReal* const uxp = attribs[PIdx::ux].dataPtr();
+    const ParticleReal* const uyp = attribs[PIdx::uy].dataPtr();
+    const ParticleReal* const uzp = attribs[PIdx::uz].dataPtr();
+    const int* ion_lev = nullptr;
+    if (do_field_ionization) {
+        ion_lev = pti.GetiAttribs(particle_icomps["ionization_level"]).dataPtr();
+    }
+    const auto GetPosition = GetParticlePosition(pti);
+    const Real q = this->charge;
+    const int nmodes = WarpX::n_rz_azimuthal_modes;
+
+    // The depositors read the momenta and positions right after they are written by the
+    // push of the same particle, while they are still in registers or in cache
+    if (WarpX::current_deposition_algo == CurrentDepositionAlgo::Esirkepov) {
+        if        (WarpX::nox == 1){
+            PushPXImpl(pti, exfab, eyfab, ezfab, bxfab, byfab, bzfab, ngE, 0, np,
+                       lev, lev, dt, ScaleFields(false), a_dt_type,
+                       makeFusedCurrentDeposition(EsirkepovCurrentDepositor<1>(
+                           GetPosition, wp, uxp, uyp, uzp, ion_lev, dt, dx, xyzmin, lo, q, nmodes),
+                           jx_arr, jy_arr, jz_arr));
+        } else if (WarpX::nox == 2){
+            PushPXImpl(pti, exfab, eyfab, ezfab, bxfab, byfab, bzfab, ngE, 0, np,
+                       lev, lev, dt, ScaleFields(false), a_dt_type,
+                       makeFusedCurrentDeposition(EsirkepovCurrentDepositor<2>(
+                           GetPosition, wp, uxp, uyp, uzp, ion_lev, dt, dx, xyzmin, lo, q, nmodes),
+                           jx_arr, jy_arr, jz_arr));
+        } else if (WarpX::nox == 3){
+            PushPXImpl(pti, exfab, eyfab, ezfab, bxfab, byfab, bzfab, ngE, 0, np,
+                       lev, lev, dt, ScaleFields(false), a_dt_type,
+                       makeFusedCurrentDeposition(EsirkepovCurrentDepositor<3>(
+                           GetPosition, wp, uxp, uyp, uzp, ion_lev, dt, dx, xyzmin, lo, q, nmodes),
+                           jx_arr, jy_arr, jz_arr));
+        } else if (WarpX::nox == 4){
+            PushPXImpl(pti, exfab, eyfab, ezfab, bxfab, byfab, bzfab, ngE, 0, np,
+                       lev, lev, dt, ScaleFields(false), a_dt_type,
+                       makeFusedCurrentDeposition(EsirkepovCurrentDepositor<4>(
+                           GetPosition, wp, uxp, uyp, uzp, ion_lev, dt, dx, xyzmin, lo, q, nmodes),
+                           jx_arr, jy_arr, jz_arr));
+        } else if (WarpX::nox == 5){
+            PushPXImpl(pti, exfab, eyfab, ezfab, bxfab, byfab, bzfab, ngE, 0, np,
+                       lev, lev, dt, ScaleFields(false), a_dt_type,
+                       makeFusedCurrentDeposition(EsirkepovCurrentDepositor<5>(
+                           GetPosition, wp, uxp, uyp, uzp, ion_lev, dt, dx, xyzmin, lo, q, nmodes),
+                           jx_arr, jy_arr, jz_arr));
+        }
+    } else {
+        const IntVect jx_type = jx_fab.box().type();
+        const IntVect jy_type = jy_fab.box().type();
+        const IntVect jz_type = jz_fab.box().type();
+        const Real relative_t = -0.5_rt*dt;
+        if        (WarpX::nox == 1){
+            PushPXImpl(pti, exfab, eyfab, ezfab, bxfab, byfab, bzfab, ngE, 0, np,
+                       lev, lev, dt, ScaleFields(false), a_dt_type,
+                       makeFusedCurrentDeposition(DirectCurrentDepositor<1>(
+                           GetPosition, wp, uxp, uyp, uzp, ion_lev, jx_type, jy_type, jz_type,
+                           relative_t, dx, xyzmin, lo, q, nmodes),
+                           jx_arr, jy_arr, jz_arr));
+        } else if (WarpX::nox == 2){
+            PushPXImpl(pti, exfab, eyfab, ezfab, bxfab, byfab, bzfab, ngE, 0, np,
+                       lev, lev, dt, ScaleFields(false), a_dt_type,
+                       makeFusedCurrentDeposition(DirectCurrentDepositor<2>(
+                           GetPosition, wp, uxp, uyp, uzp, ion_lev, jx_type, jy_type, jz_type,
+                           relative_t, dx, xyzmin, lo, q, nmodes),
+                           jx_arr, jy_arr, jz_arr));
+        } else if (WarpX::nox == 3){
+            PushPXImpl(pti, exfab, eyfab, ezfab, bxfab, byfab, bzfab, ngE, 0, np,
+                       lev, lev, dt, ScaleFields(false), a_dt_type,
+                       makeFusedCurrentDeposition(DirectCurrentDepositor<3>(
+                           GetPosition, wp, uxp, uyp, uzp, ion_lev, jx_type, jy_type, jz_type,
+                           relative_t, dx, xyzmin, lo, q, nmodes),
+                           jx_arr, jy_arr, jz_arr));
+        } else if (WarpX::nox == 4){
+            PushPXImpl(pti, exfab, eyfab, ezfab, bxfab, byfab, bzfab, ngE, 0, np,
+                       lev, lev, dt, ScaleFields(false), a_dt_type,
+                       makeFusedCurrentDeposition(DirectCurrentDepositor<4>(
+                           GetPosition, wp, uxp, uyp, uzp, ion_lev, jx_type, jy_type, jz_type,
+                           relative_t, dx, xyzmin, lo, q, nmodes),
+                           jx_arr, jy_arr, jz_arr));
+        } else if (WarpX::nox == 5){
+            PushPXImpl(pti, exfab, eyfab, ezfab, bxfab, byfab, bzfab, ngE, 0, np,
+                       lev, lev, dt, ScaleFields(false), a_dt_type,
+                       makeFusedCurrentDeposition(DirectCurrentDepositor<5>(
+                           GetPosition, wp, uxp, uyp, uzp, ion_lev, jx_type, jy_type, jz_type,
+                           relative_t, dx, xyzmin, lo, q, nmodes),
+                           jx_arr, jy_arr, jz_arr));
+        }
+    }
+
+#ifndef AMREX_USE_GPU
+    // CPU, tiling: atomicAdd local_j<xyz> into j<xyz>
+    (*jx)[pti].atomicAdd(local_jx[thread_num], tbx, tbx, 0, 0, jx->nComp());
+    (*jy)[pti].atomicAdd(local_jy[thread_num], tby, tby, 0, 0, jy->nComp());
+    (*jz)[pti].atomicAdd(local_jz[thread_num], tbz, tbz, 0, 0, jz->nComp());
+#endif
+}
+
+template <typename DepositCurrentFunc>
+void
+PhysicalParticleContainer::PushPXImpl (WarpXParIter& pti,
+                                       amrex::FArrayBox const * exfab,
+                                       amrex::FArrayBox const * eyfab,
+                                       amrex::FArrayBox const * ezfab,
+                                       amrex::FArrayBox const * bxfab,
+                                       amrex::FArrayBox const * byfab,
+                                       amrex::FArrayBox const * bzfab,
+                                       const amrex::IntVect ngE,
+                                       const long offset,
+                                       const long np_to_push,
+                                       int lev, int gather_lev,
+                                       amrex::Real dt, ScaleFields scaleFields,
+                                       DtType a_dt_type,
+                                       DepositCurrentFunc const& deposit_current)
 {
     AMREX_ALWAYS_ASSERT_WITH_MESSAGE((gather_lev==(lev-1)) ||
                                      (gather_lev==(lev  )),
@@ -2308,7 +2589,7 @@ PhysicalParticleContainer::PushPX (WarpXParIter& pti,
     ParticleReal* const AMREX_RESTRICT uz = attribs[PIdx::uz].dataPtr() + offset;
 
     auto copyAttribs = CopyParticleAttribs(pti, tmp_particle_data, offset);
-    int do_copy = (WarpX::do_back_transformed_diagnostics &&
+    int do_copy = (WarpX::do_back_transformed_particles &&
                           do_back_transformed_diagnostics &&
                    (a_dt_type!=DtType::SecondHalf));
 
@@ -2339,6 +2620,61 @@ PhysicalParticleContainer::PushPX (WarpXParIter& pti,
 
     const auto t_do_not_gather = do_not_gather;
 
+#if !defined(AMREX_USE_GPU) && !defined(WARPX_DIM_RZ)
+    // On CPU, process the particles by batches with the SIMD kernels, unless
+    // radiation reaction or QED require the single-particle pusher
+    bool use_simd = WarpX::do_simd_particle_push && !do_crr && !DepositCurrentFunc::deposits;
+#ifdef WARPX_QED
+    use_simd = use_simd && !local_has_quantum_sync;
+#endif
+    if (use_simd) {
+        constexpr int W = WarpXSIMD::width;
+        for (long ib = 0; ib < np_to_push; ib += W) {
+            const int n = static_cast<int>(std::min(static_cast<long>(W), np_to_push - ib));
+
+            amrex::ParticleReal xp[W], yp[W], zp[W];
+            amrex::ParticleReal Exp[W], Eyp[W], Ezp[W];
+            amrex::ParticleReal Bxp[W], Byp[W], Bzp[W];
+            amrex::Real qp[W];
+            for (int l = 0; l < n; ++l) {
+                const long ip = ib + l;
+                getPosition(ip, xp[l], yp[l], zp[l]);
+                Exp[l] = 0._rt; Eyp[l] = 0._rt; Ezp[l] = 0._rt;
+                Bxp[l] = 0._rt; Byp[l] = 0._rt; Bzp[l] = 0._rt;
+                qp[l] = (ion_lev && ion_lev[ip]) ? q*ion_lev[ip] : q;
+            }
+
+            if(!t_do_not_gather){
+                // first gather E and B to the particle positions
+                doGatherShapeNSIMD(n, xp, yp, zp, Exp, Eyp, Ezp, Bxp, Byp, Bzp,
+                                   ex_arr, ey_arr, ez_arr, bx_arr, by_arr, bz_arr,
+                                   ex_type, ey_type, ez_type, bx_type, by_type, bz_type,
+                                   dx_arr, xyzmin_arr, lo, nox, galerkin_interpolation);
+            }
+
+            for (int l = 0; l < n; ++l) {
+                const long ip = ib + l;
+                // Externally applied E-field in Cartesian co-ordinates
+                getExternalE(ip, Exp[l], Eyp[l], Ezp[l]);
+                // Externally applied B-field in Cartesian co-ordinates
+                getExternalB(ip, Bxp[l], Byp[l], Bzp[l]);
+
+                scaleFields(xp[l], yp[l], zp[l], Exp[l], Eyp[l], Ezp[l], Bxp[l], Byp[l], Bzp[l]);
+
+                if (do_copy) copyAttribs(ip);
+            }
+
+            doParticlePushSIMD(n, xp, yp, zp, ux + ib, uy + ib, uz + ib,
+                               Exp, Eyp, Ezp, Bxp, Byp, Bzp, qp, m, pusher_algo, dt);
+
+            for (int l = 0; l < n; ++l) {
+                setPosition(ib + l, xp[l], yp[l], zp[l]);
+            }
+        }
+        return;
+    }
+#endif
+
     amrex::ParallelFor( np_to_push, [=] AMREX_GPU_DEVICE (long ip)
     {
         amrex::ParticleReal xp, yp, zp;
@@ -2381,6 +2717,7 @@ PhysicalParticleContainer::PushPX (WarpXParIter& pti,
         }
 #endif
 
+        deposit_current(ip);
     });
 }
 
@@ -0,0 +1,166 @@
+/* Copyright 2026 The WarpX Community
+ *
+ * This file is part of WarpX.
+ *
+ * License: BSD-3-Clause-LBNL
+ */
+#include "SortingPolicy.H"
+
+#include "Particles/WarpXParticleContainer.H"
+#include "Utils/WarpXUtil.H"
+#include "WarpX.H"
+
+#include <AMReX.H>
+#include <AMReX_Box.H>
+#include <AMReX_Geometry.H>
+#include <AMReX_GpuQualifiers.H>
+#include <AMReX_ParIter.H>
+#include <AMReX_ParmParse.H>
+#include <AMReX_ParticleUtil.H>
+#include <AMReX_Reduce.H>
+#include <AMReX_Vector.H>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace amrex::literals;
+
+namespace
+{
+    void ReadSortingPolicy (amrex::ParmParse& pp, bool& adaptive)
+    {
+        std::string policy = adaptive ? "adaptive" : "intervals";
+        pp.query("sort_policy", policy);
+        if (policy == "adaptive") {
+            adaptive = true;
+        } else if (policy == "intervals") {
+            adaptive = false;
+        } else {
+            amrex::Abort("Unknown sort_policy " + policy + ": must be intervals or adaptive");
+        }
+    }
+}
+
+SortingPolicy::SortingPolicy ()
+    : m_sort_intervals(WarpX::sort_intervals), m_bin_size(WarpX::sort_bin_size)
+{
+    amrex::ParmParse pp_warpx("warpx");
+    ReadSortingPolicy(pp_warpx, m_adaptive);
+    queryWithParser(pp_warpx, "sort_min_disorder", m_min_disorder);
+    pp_warpx.query("sort_timing_interval", m_timing_interval);
+}
+
+SortingPolicy::SortingPolicy (const std::string& species_name)
+    : SortingPolicy()
+{
+    amrex::ParmParse pp_species_name(species_name);
+    ReadSortingPolicy(pp_species_name, m_adaptive);
+    queryWithParser(pp_species_name, "sort_min_disorder", m_min_disorder);
+    pp_species_name.query("sort_timing_interval", m_timing_interval);
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(m_timing_interval > 0,
+        species_name + ".sort_timing_interval must be positive");
+
+    std::vector<std::string> sort_intervals_string_vec;
+    if (pp_species_name.queryarr("sort_intervals", sort_intervals_string_vec)) {
+        m_sort_intervals = IntervalsParser(sort_intervals_string_vec);
+    }
+
+    amrex::Vector<int> vect_sort_bin_size(AMREX_SPACEDIM,1);
+    if (pp_species_name.queryarr("sort_bin_size", vect_sort_bin_size)) {
+        for (int i=0; i<AMREX_SPACEDIM; i++)
+            m_bin_size[i] = vect_sort_bin_size[i];
+    }
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(m_bin_size.allGT(0),
+        species_name + ".sort_bin_size must be positive");
+}
+
+bool
+SortingPolicy::shouldSort (const int step, const WarpXParticleContainer& pc)
+{
+    if (!m_adaptive) return m_sort_intervals.contains(step);
+
+    // Close the measurement of the step that just finished, if it was timed.
+    // The decision is only taken after a timed step.
+    const amrex::Long np = m_step_num_particles;
+    if (np == 0) return false;
+    const amrex::Real time_per_particle = m_step_time/np;
+    if (m_ref_time_per_particle < 0._rt || time_per_particle < m_ref_time_per_particle) {
+        m_ref_time_per_particle = time_per_particle;
+    }
+    // The steps between two measurements are assumed to lose as much time as the measured one
+    m_excess_time += (time_per_particle - m_ref_time_per_particle)*np*m_timing_interval;
+    m_step_time = 0._rt;
+    m_step_num_particles = 0;
+
+    // Until the species has been sorted once, the cost of a sort is estimated as one step
+    const amrex::Real sort_cost = (m_sort_time >= 0._rt) ?
+        m_sort_time : m_ref_time_per_particle*np;
+    if (m_excess_time <= sort_cost) return false;
+
+    if (DisorderFraction(pc) < m_min_disorder) {
+        // The slowdown is not due to the order of the particles (e.g. the density changed):
+        // measure it again from the current step
+        m_ref_time_per_particle = -1._rt;
+        m_excess_time = 0._rt;
+        return false;
+    }
+    return true;
+}
+
+void
+SortingPolicy::addEvolveTime (const amrex::Real time, const amrex::Long num_particles)
+{
+    m_step_time += time;
+    m_step_num_particles = std::max(m_step_num_particles, num_particles);
+}
+
+void
+SortingPolicy::sorted (const amrex::Real time)
+{
+    m_sort_time = time;
+    m_ref_time_per_particle = -1._rt;
+    m_excess_time = 0._rt;
+}
+
+amrex::Real
+SortingPolicy::DisorderFraction (const WarpXParticleContainer& pc) const
+{
+    using ParConstIter = amrex::ParConstIter<0,0,PIdx::nattribs>;
+
+    amrex::ReduceOps<amrex::ReduceOpSum, amrex::ReduceOpSum> reduce_op;
+    amrex::ReduceData<amrex::Long, amrex::Long> reduce_data(reduce_op);
+    using ReduceTuple = typename decltype(reduce_data)::Type;
+
+    const amrex::IntVect bin_size = m_bin_size;
+    for (int lev = 0; lev <= pc.finestLevel(); ++lev)
+    {
+        const auto plo = pc.Geom(lev).ProbLoArray();
+        const auto dxi = pc.Geom(lev).InvCellSizeArray();
+        const amrex::Box domain = pc.Geom(lev).Domain();
+        for (ParConstIter pti(pc, lev); pti.isValid(); ++pti)
+        {
+            const long np = pti.numParticles();
+            if (np < 2) continue;
+            // Same bins as in amrex::ParticleContainer::SortParticlesByBin
+            const amrex::Box box = pti.validbox();
+            const auto * const AMREX_RESTRICT pstruct = pti.GetArrayOfStructs()().dataPtr();
+            reduce_op.eval(np-1, reduce_data,
+                [=] AMREX_GPU_DEVICE (long i) -> ReduceTuple
+                {
+                    amrex::Box tbx;
+                    const int bin_prev = amrex::getTileIndex(
+                        amrex::getParticleCell(pstruct[i], plo, dxi, domain),
+                        box, true, bin_size, tbx);
+                    const int bin = amrex::getTileIndex(
+                        amrex::getParticleCell(pstruct[i+1], plo, dxi, domain),
+                        box, true, bin_size, tbx);
+                    return {bin < bin_prev ? 1 : 0, 1};
+                });
+        }
+    }
+    ReduceTuple hv = reduce_data.value();
+    const amrex::Long num_descents = amrex::get<0>(hv);
+    const amrex::Long num_pairs = amrex::get<1>(hv);
+    return (num_pairs > 0) ? amrex::Real(num_descents)/amrex::Real(num_pairs) : 0._rt;
+}
@@ -9,6 +9,7 @@
  */
 #include "WarpXParticleContainer.H"
 
+#include "Deposition/BlockedCurrentDeposition.H"
 #include "Deposition/ChargeDeposition.H"
 #include "Deposition/CurrentDeposition.H"
 #include "Pusher/GetAndSetPosition.H"
@@ -60,6 +61,7 @@
 #endif
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 
 using namespace amrex;
@@ -373,22 +375,28 @@ WarpXParticleContainer::DepositCurrent (WarpXParIter& pti,
     tby.grow(ng_J);
     tbz.grow(ng_J);
 
+    // With the blocked deposition, particles deposit in small thread-private buffers,
+    // which are directly added to j<xyz>
+    const bool use_local_j = !WarpX::do_blocked_current_deposition;
+
     // CPU, tiling: j<xyz>_arr point to the local_j<xyz>[thread_num] arrays
-    local_jx[thread_num].resize(tbx, jx->nComp());
-    local_jy[thread_num].resize(tby, jy->nComp());
-    local_jz[thread_num].resize(tbz, jz->nComp());
-
-    // local_jx[thread_num] is set to zero
-    local_jx[thread_num].setVal(0.0);
-    local_jy[thread_num].setVal(0.0);
-    local_jz[thread_num].setVal(0.0);
-
-    auto & jx_fab = local_jx[thread_num];
-    auto & jy_fab = local_jy[thread_num];
-    auto & jz_fab = local_jz[thread_num];
-    Array4<Real> const& jx_arr = local_jx[thread_num].array();
-    Array4<Real> const& jy_arr = local_jy[thread_num].array();
-    Array4<Real> const& jz_arr = local_jz[thread_num].array();
+    if (use_local_j) {
+        local_jx[thread_num].resize(tbx, jx->nComp());
+        local_jy[thread_num].resize(tby, jy->nComp());
+        local_jz[thread_num].resize(tbz, jz->nComp());
+
+        // local_jx[thread_num] is set to zero
+        local_jx[thread_num].setVal(0.0);
+        local_jy[thread_num].setVal(0.0);
+        local_jz[thread_num].setVal(0.0);
+    }
+
+    auto & jx_fab = use_local_j ? local_jx[thread_num] : (*jx)[pti];
+    auto & jy_fab = use_local_j ? local_jy[thread_num] : (*jy)[pti];
+    auto & jz_fab = use_local_j ? local_jz[thread_num] : (*jz)[pti];
+    Array4<Real> const& jx_arr = jx_fab.array();
+    Array4<Real> const& jy_arr = jy_fab.array();
+    Array4<Real> const& jz_arr = jz_fab.array();
 #endif
 
     const auto GetPosition = GetParticlePosition(pti, offset);
@@ -427,7 +435,132 @@ WarpXParticleContainer::DepositCurrent (WarpXParIter& pti,
     amrex::LayoutData<amrex::Real> * const costs = WarpX::getCosts(lev);
     amrex::Real * const cost = costs ? &((*costs)[pti.index()]) : nullptr;
 
-    if (WarpX::current_deposition_algo == CurrentDepositionAlgo::Esirkepov) {
+    if (WarpX::do_blocked_current_deposition) {
+        // Blocks of cells, aligned with the bins of SortParticlesByBin when
+        // current_deposition_block_size is equal to sort_bin_size
+        const IntVect& block_size = WarpX::current_deposition_block_size;
+        // The blocks cover all the guard cells in which particles are allowed by the range check
+        // above, i.e. ng_J on CPU and the guard cells of J on GPU
+        const IntVect ng_blocks = range + shape_extent;
+        Box block_domain = tilebox;
+        block_domain.grow(-ng_J);
+        for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
+            block_domain.growLo(idim, ((ng_blocks[idim] + block_size[idim] - 1)/block_size[idim])*block_size[idim]);
+            block_domain.growHi(idim, ng_blocks[idim]);
+        }
+        const CurrentDepositionBlocks blocks(block_domain, block_size, dx, xyzmin, lo);
+        const ParticleType * const pstruct = pti.GetArrayOfStructs()().dataPtr() + offset;
+
+        // Cells around a block reached by the shape of its particles. For the direct deposition,
+        // this includes the displacement of the particles until the time of the deposition
+        // (the Esirkepov shape factors already account for the displacement over one step).
+        IntVect guard(static_cast<int>(WarpX::nox/2 + 1));
+        if (WarpX::current_deposition_algo != CurrentDepositionAlgo::Esirkepov) {
+#if (AMREX_SPACEDIM == 3)
+            const std::array<Real,AMREX_SPACEDIM> dx_depos = {dx[0], dx[1], dx[2]};
+#else
+            const std::array<Real,AMREX_SPACEDIM> dx_depos = {dx[0], dx[2]};
+#endif
+            for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
+                guard[idim] += static_cast<int>(
+                    std::ceil(PhysConst::c*std::abs(dt*relative_time)/dx_depos[idim]));
+            }
+        }
+
+        if (WarpX::current_deposition_algo == CurrentDepositionAlgo::Esirkepov) {
+            if        (WarpX::nox == 1){
+                doBlockedCurrentDeposition(
+                    EsirkepovCurrentDepositor<1>(
+                        GetPosition, wp.dataPtr() + offset, uxp.dataPtr() + offset,
+                        uyp.dataPtr() + offset, uzp.dataPtr() + offset, ion_lev,
+                        dt, dx, xyzmin, lo, q, WarpX::n_rz_azimuthal_modes),
+                    pstruct, np_to_depose, blocks, guard, jx_fab, jy_fab, jz_fab,
+                    cost, WarpX::load_balance_costs_update_algo);
+            } else if (WarpX::nox == 2){
+                doBlockedCurrentDeposition(
+                    EsirkepovCurrentDepositor<2>(
+                        GetPosition, wp.dataPtr() + offset, uxp.dataPtr() + offset,
+                        uyp.dataPtr() + offset, uzp.dataPtr() + offset, ion_lev,
+                        dt, dx, xyzmin, lo, q, WarpX::n_rz_azimuthal_modes),
+                    pstruct, np_to_depose, blocks, guard, jx_fab, jy_fab, jz_fab,
+                    cost, WarpX::load_balance_costs_update_algo);
+            } else if (WarpX::nox == 3){
+                doBlockedCurrentDeposition(
+                    EsirkepovCurrentDepositor<3>(
+                        GetPosition, wp.dataPtr() + offset, uxp.dataPtr() + offset,
+                        uyp.dataPtr() + offset, uzp.dataPtr() + offset, ion_lev,
+                        dt, dx, xyzmin, lo, q, WarpX::n_rz_azimuthal_modes),
+                    pstruct, np_to_depose, blocks, guard, jx_fab, jy_fab, jz_fab,
+                    cost, WarpX::load_balance_costs_update_algo);
+            } else if (WarpX::nox == 4){
+                doBlockedCurrentDeposition(
+                    EsirkepovCurrentDepositor<4>(
+                        GetPosition, wp.dataPtr() + offset, uxp.dataPtr() + offset,
+                        uyp.dataPtr() + offset, uzp.dataPtr() + offset, ion_lev,
+                        dt, dx, xyzmin, lo, q, WarpX::n_rz_azimuthal_modes),
+                    pstruct, np_to_depose, blocks, guard, jx_fab, jy_fab, jz_fab,
+                    cost, WarpX::load_balance_costs_update_algo);
+            } else if (WarpX::nox == 5){
+                doBlockedCurrentDeposition(
+                    EsirkepovCurrentDepositor<5>(
+                        GetPosition, wp.dataPtr() + offset, uxp.dataPtr() + offset,
+                        uyp.dataPtr() + offset, uzp.dataPtr() + offset, ion_lev,
+                        dt, dx, xyzmin, lo, q, WarpX::n_rz_azimuthal_modes),
+                    pstruct, np_to_depose, blocks, guard, jx_fab, jy_fab, jz_fab,
+                    cost, WarpX::load_balance_costs_update_algo);
+            }
+        } else {
+            const IntVect jx_type = jx_fab.box().type();
+            const IntVect jy_type = jy_fab.box().type();
+            const IntVect jz_type = jz_fab.box().type();
+            if        (WarpX::nox == 1){
+                doBlockedCurrentDeposition(
+                    DirectCurrentDepositor<1>(
+                        GetPosition, wp.dataPtr() + offset, uxp.dataPtr() + offset,
+                        uyp.dataPtr() + offset, uzp.dataPtr() + offset, ion_lev,
+                        jx_type, jy_type, jz_type, dt*relative_time, dx, xyzmin, lo, q,
+                        WarpX::n_rz_azimuthal_modes),
+                    pstruct, np_to_depose, blocks, guard, jx_fab, jy_fab, jz_fab,
+                    cost, WarpX::load_balance_costs_update_algo);
+            } else if (WarpX::nox == 2){
+                doBlockedCurrentDeposition(
+                    DirectCurrentDepositor<2>(
+                        GetPosition, wp.dataPtr() + offset, uxp.dataPtr() + offset,
+                        uyp.dataPtr() + offset, uzp.dataPtr() + offset, ion_lev,
+                        jx_type, jy_type, jz_type, dt*relative_time, dx, xyzmin, lo, q,
+                        WarpX::n_rz_azimuthal_modes),
+                    pstruct, np_to_depose, blocks, guard, jx_fab, jy_fab, jz_fab,
+                    cost, WarpX::load_balance_costs_update_algo);
+            } else if (WarpX::nox == 3){
+                doBlockedCurrentDeposition(
+                    DirectCurrentDepositor<3>(
+                        GetPosition, wp.dataPtr() + offset, uxp.dataPtr() + offset,
+                        uyp.dataPtr() + offset, uzp.dataPtr() + offset, ion_lev,
+                        jx_type, jy_type, jz_type, dt*relative_time, dx, xyzmin, lo, q,
+                        WarpX::n_rz_azimuthal_modes),
+                    pstruct, np_to_depose, blocks, guard, jx_fab, jy_fab, jz_fab,
+                    cost, WarpX::load_balance_costs_update_algo);
+            } else if (WarpX::nox == 4){
+                doBlockedCurrentDeposition(
+                    DirectCurrentDepositor<4>(
+                        GetPosition, wp.dataPtr() + offset, uxp.dataPtr() + offset,
+                        uyp.dataPtr() + offset, uzp.dataPtr() + offset, ion_lev,
+                        jx_type, jy_type, jz_type, dt*relative_time, dx, xyzmin, lo, q,
+                        WarpX::n_rz_azimuthal_modes),
+                    pstruct, np_to_depose, blocks, guard, jx_fab, jy_fab, jz_fab,
+                    cost, WarpX::load_balance_costs_update_algo);
+            } else if (WarpX::nox == 5){
+                doBlockedCurrentDeposition(
+                    DirectCurrentDepositor<5>(
+                        GetPosition, wp.dataPtr() + offset, uxp.dataPtr() + offset,
+                        uyp.dataPtr() + offset, uzp.dataPtr() + offset, ion_lev,
+                        jx_type, jy_type, jz_type, dt*relative_time, dx, xyzmin, lo, q,
+                        WarpX::n_rz_azimuthal_modes),
+                    pstruct, np_to_depose, blocks, guard, jx_fab, jy_fab, jz_fab,
+                    cost, WarpX::load_balance_costs_update_algo);
+            }
+        }
+    } else if (WarpX::current_deposition_algo == CurrentDepositionAlgo::Esirkepov) {
         if        (WarpX::nox == 1){
             doEsirkepovDepositionShapeN<1>(
                 GetPosition, wp.dataPtr() + offset, uxp.dataPtr() + offset,
@@ -449,6 +582,20 @@ WarpXParticleContainer::DepositCurrent (WarpXParIter& pti,
                 jx_arr, jy_arr, jz_arr, np_to_depose, dt, dx, xyzmin, lo, q,
                 WarpX::n_rz_azimuthal_modes, cost,
                 WarpX::load_balance_costs_update_algo);
+        } else if (WarpX::nox == 4){
+            doEsirkepovDepositionShapeN<4>(
+                GetPosition, wp.dataPtr() + offset, uxp.dataPtr() + offset,
+                uyp.dataPtr() + offset, uzp.dataPtr() + offset, ion_lev,
+                jx_arr, jy_arr, jz_arr, np_to_depose, dt, dx, xyzmin, lo, q,
+                WarpX::n_rz_azimuthal_modes, cost,
+                WarpX::load_balance_costs_update_algo);
+        } else if (WarpX::nox == 5){
+            doEsirkepovDepositionShapeN<5>(
+                GetPosition, wp.dataPtr() + offset, uxp.dataPtr() + offset,
+                uyp.dataPtr() + offset, uzp.dataPtr() + offset, ion_lev,
+                jx_arr, jy_arr, jz_arr, np_to_depose, dt, dx, xyzmin, lo, q,
+                WarpX::n_rz_azimuthal_modes, cost,
+                WarpX::load_balance_costs_update_algo);
         }
     } else if (WarpX::current_deposition_algo == CurrentDepositionAlgo::Vay) {
         if        (WarpX::nox == 1){
@@ -472,6 +619,20 @@ WarpXParticleContainer::DepositCurrent (WarpXParIter& pti,
                 jx_fab, jy_fab, jz_fab, np_to_depose, dt, dx, xyzmin, lo, q,
                 WarpX::n_rz_azimuthal_modes, cost,
                 WarpX::load_balance_costs_update_algo);
+        } else if (WarpX::nox == 4){
+            doVayDepositionShapeN<4>(
+                GetPosition, wp.dataPtr() + offset, uxp.dataPtr() + offset,
+                uyp.dataPtr() + offset, uzp.dataPtr() + offset, ion_lev,
+                jx_fab, jy_fab, jz_fab, np_to_depose, dt, dx, xyzmin, lo, q,
+                WarpX::n_rz_azimuthal_modes, cost,
+                WarpX::load_balance_costs_update_algo);
+        } else if (WarpX::nox == 5){
+            doVayDepositionShapeN<5>(
+                GetPosition, wp.dataPtr() + offset, uxp.dataPtr() + offset,
+                uyp.dataPtr() + offset, uzp.dataPtr() + offset, ion_lev,
+                jx_fab, jy_fab, jz_fab, np_to_depose, dt, dx, xyzmin, lo, q,
+                WarpX::n_rz_azimuthal_modes, cost,
+                WarpX::load_balance_costs_update_algo);
         }
     } else {
         if        (WarpX::nox == 1){
@@ -495,17 +656,33 @@ WarpXParticleContainer::DepositCurrent (WarpXParIter& pti,
                 jx_fab, jy_fab, jz_fab, np_to_depose, dt*relative_time, dx,
                 xyzmin, lo, q, WarpX::n_rz_azimuthal_modes, cost,
                 WarpX::load_balance_costs_update_algo);
+        } else if (WarpX::nox == 4){
+            doDepositionShapeN<4>(
+                GetPosition, wp.dataPtr() + offset, uxp.dataPtr() + offset,
+                uyp.dataPtr() + offset, uzp.dataPtr() + offset, ion_lev,
+                jx_fab, jy_fab, jz_fab, np_to_depose, dt*relative_time, dx,
+                xyzmin, lo, q, WarpX::n_rz_azimuthal_modes, cost,
+                WarpX::load_balance_costs_update_algo);
+        } else if (WarpX::nox == 5){
+            doDepositionShapeN<5>(
+                GetPosition, wp.dataPtr() + offset, uxp.dataPtr() + offset,
+                uyp.dataPtr() + offset, uzp.dataPtr() + offset, ion_lev,
+                jx_fab, jy_fab, jz_fab, np_to_depose, dt*relative_time, dx,
+                xyzmin, lo, q, WarpX::n_rz_azimuthal_modes, cost,
+                WarpX::load_balance_costs_update_algo);
         }
     }
     WARPX_PROFILE_VAR_STOP(blp_deposit);
 
 #ifndef AMREX_USE_GPU
     // CPU, tiling: atomicAdd local_j<xyz> into j<xyz>
-    WARPX_PROFILE_VAR_START(blp_accumulate);
-    (*jx)[pti].atomicAdd(local_jx[thread_num], tbx, tbx, 0, 0, jx->nComp());
-    (*jy)[pti].atomicAdd(local_jy[thread_num], tby, tby, 0, 0, jy->nComp());
-    (*jz)[pti].atomicAdd(local_jz[thread_num], tbz, tbz, 0, 0, jz->nComp());
-    WARPX_PROFILE_VAR_STOP(blp_accumulate);
+    if (use_local_j) {
+        WARPX_PROFILE_VAR_START(blp_accumulate);
+        (*jx)[pti].atomicAdd(local_jx[thread_num], tbx, tbx, 0, 0, jx->nComp());
+        (*jy)[pti].atomicAdd(local_jy[thread_num], tby, tby, 0, 0, jy->nComp());
+        (*jz)[pti].atomicAdd(local_jz[thread_num], tbz, tbz, 0, 0, jz->nComp());
+        WARPX_PROFILE_VAR_STOP(blp_accumulate);
+    }
 #endif
 }
 
@@ -704,6 +881,16 @@ WarpXParticleContainer::DepositCharge (WarpXParIter& pti, RealVector& wp,
                                     rho_fab, np_to_depose, dx, xyzmin, lo, q,
                                     WarpX::n_rz_azimuthal_modes, cost,
                                     WarpX::load_balance_costs_update_algo);
+    } else if (WarpX::nox == 4){
+        doChargeDepositionShapeN<4>(GetPosition, wp.dataPtr()+offset, ion_lev,
+                                    rho_fab, np_to_depose, dx, xyzmin, lo, q,
+                                    WarpX::n_rz_azimuthal_modes, cost,
+                                    WarpX::load_balance_costs_update_algo);
+    } else if (WarpX::nox == 5){
+        doChargeDepositionShapeN<5>(GetPosition, wp.dataPtr()+offset, ion_lev,
+                                    rho_fab, np_to_depose, dx, xyzmin, lo, q,
+                                    WarpX::n_rz_azimuthal_modes, cost,
+                                    WarpX::load_balance_costs_update_algo);
     }
     WARPX_PROFILE_VAR_STOP(blp_ppc_chd);
 
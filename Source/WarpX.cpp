@@ -12,7 +12,6 @@
 #include "WarpX.H"
 
 #include "BoundaryConditions/PML.H"
-#include "Diagnostics/BackTransformedDiagnostic.H"
 #include "Diagnostics/MultiDiagnostics.H"
 #include "Diagnostics/ReducedDiags/MultiReducedDiags.H"
 #include "FieldSolver/FiniteDifferenceSolver/FiniteDifferenceSolver.H"
@@ -220,16 +219,17 @@ int WarpX::num_mirrors = 0;
 IntervalsParser WarpX::sort_intervals;
 amrex::IntVect WarpX::sort_bin_size(AMREX_D_DECL(1,1,1));
 
-bool WarpX::do_back_transformed_diagnostics = false;
-std::string WarpX::lab_data_directory = "lab_frame_data";
-int  WarpX::num_snapshots_lab = std::numeric_limits<int>::lowest();
-Real WarpX::dt_snapshots_lab  = std::numeric_limits<Real>::lowest();
-bool WarpX::do_back_transformed_fields = true;
-bool WarpX::do_back_transformed_particles = true;
+bool WarpX::do_blocked_current_deposition = false;
+bool WarpX::do_simd_particle_push = false;
+bool WarpX::do_fused_push_and_deposition = false;
+#if (AMREX_SPACEDIM == 3)
+amrex::IntVect WarpX::current_deposition_block_size(AMREX_D_DECL(4,4,4));
+#else
+amrex::IntVect WarpX::current_deposition_block_size(AMREX_D_DECL(8,8,8));
+#endif
 
-int  WarpX::num_slice_snapshots_lab = 0;
-Real WarpX::dt_slice_snapshots_lab;
-Real WarpX::particle_slice_width_lab = 0.0_rt;
+bool WarpX::do_back_transformed_diagnostics = false;
+bool WarpX::do_back_transformed_particles = false;
 
 bool WarpX::do_dynamic_scheduling = true;
 
@@ -315,7 +315,6 @@ WarpX::WarpX ()
             current_injection_position = geom[0].ProbLo(moving_window_dir);
         }
     }
-    do_back_transformed_particles = mypc->doBackTransformedDiagnostics();
 
     // Diagnostics
     multi_diags = std::make_unique<MultiDiagnostics>();
@@ -414,6 +413,8 @@ WarpX::WarpX ()
                     costs_heuristic_particles_wt = 0.595_rt;
                     break;
                 case 3:
+                case 4: // not measured for orders 4 and 5: use the weights of order 3
+                case 5:
                     costs_heuristic_cells_wt = 0.250_rt;
                     costs_heuristic_particles_wt = 0.750_rt;
                     break;
@@ -430,6 +431,8 @@ WarpX::WarpX ()
                     costs_heuristic_particles_wt = 0.732_rt;
                     break;
                 case 3:
+                case 4: // not measured for orders 4 and 5: use the weights of order 3
+                case 5:
                     costs_heuristic_cells_wt = 0.145_rt;
                     costs_heuristic_particles_wt = 0.855_rt;
                     break;
@@ -498,6 +501,7 @@ WarpX::ReadParameters ()
         ParmParse pp_amr("amr");
 
         pp_amr.query("restart", restart_chkfile);
+        pp_amr.query("restart_regrid", restart_regrid);
     }
 
     {
@@ -602,43 +606,26 @@ WarpX::ReadParameters ()
             moving_window_v *= PhysConst::c;
         }
 
-        pp_warpx.query("do_back_transformed_diagnostics", do_back_transformed_diagnostics);
-        if (do_back_transformed_diagnostics) {
-
-            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(gamma_boost > 1.0,
-                   "gamma_boost must be > 1 to use the boosted frame diagnostic.");
-
-            pp_warpx.query("lab_data_directory", lab_data_directory);
-
-            std::string s;
-            pp_warpx.get("boost_direction", s);
-            AMREX_ALWAYS_ASSERT_WITH_MESSAGE( (s == "z" || s == "Z"),
-                   "The boosted frame diagnostic currently only works if the boost is in the z direction.");
-
-            pp_warpx.get("num_snapshots_lab", num_snapshots_lab);
-
-            // Read either dz_snapshots_lab or dt_snapshots_lab
-            bool snapshot_interval_is_specified = 0;
-            Real dz_snapshots_lab = 0;
-            snapshot_interval_is_specified += queryWithParser(pp_warpx, "dt_snapshots_lab", dt_snapshots_lab);
-            if ( queryWithParser(pp_warpx, "dz_snapshots_lab", dz_snapshots_lab) ){
-                dt_snapshots_lab = dz_snapshots_lab/PhysConst::c;
-                snapshot_interval_is_specified = 1;
+        // Back-transformed diagnostics are diagnostics with <diag_name>.diag_type = BackTransformed.
+        // When there is any, rho is deposited if it is requested in the output. When any of
+        // them back-transforms the particles, the particles save the data required to
+        // back-transform them during the push.
+        {
+            ParmParse pp_diagnostics("diagnostics");
+            int enable_diags = 1;
+            pp_diagnostics.query("enable", enable_diags);
+            std::vector<std::string> diags_names;
+            if (enable_diags == 1) pp_diagnostics.queryarr("diags_names", diags_names);
+            for (const auto& diag_name : diags_names) {
+                ParmParse pp_diag_name(diag_name);
+                std::string diag_type_str;
+                pp_diag_name.query("diag_type", diag_type_str);
+                if (diag_type_str != "BackTransformed") continue;
+                do_back_transformed_diagnostics = true;
+                bool do_back_transformed_particles_diag = false;
+                pp_diag_name.query("do_back_transformed_particles", do_back_transformed_particles_diag);
+                if (do_back_transformed_particles_diag) do_back_transformed_particles = true;
             }
-            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
-                snapshot_interval_is_specified,
-                "When using back-transformed diagnostics, user should specify either dz_snapshots_lab or dt_snapshots_lab.");
-
-            getWithParser(pp_warpx, "gamma_boost", gamma_boost);
-
-            pp_warpx.query("do_back_transformed_fields", do_back_transformed_fields);
-
-            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(do_moving_window,
-                   "The moving window should be on if using the boosted frame diagnostic.");
-
-            pp_warpx.get("moving_window_dir", s);
-            AMREX_ALWAYS_ASSERT_WITH_MESSAGE( (s == "z" || s == "Z"),
-                   "The boosted frame diagnostic currently only works if the moving window is in the z direction.");
         }
 
         do_electrostatic = GetAlgorithmInteger(pp_warpx, "do_electrostatic");
@@ -724,6 +711,21 @@ WarpX::ReadParameters ()
                 sort_bin_size[i] = vect_sort_bin_size[i];
         }
 
+        pp_warpx.query("do_blocked_current_deposition", do_blocked_current_deposition);
+        Vector<int> vect_block_size(AMREX_SPACEDIM);
+        for (int i=0; i<AMREX_SPACEDIM; i++)
+            vect_block_size[i] = current_deposition_block_size[i];
+        if (pp_warpx.queryarr("current_deposition_block_size", vect_block_size)){
+            for (int i=0; i<AMREX_SPACEDIM; i++)
+                current_deposition_block_size[i] = vect_block_size[i];
+        }
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
+            current_deposition_block_size.allGT(0),
+            "warpx.current_deposition_block_size must be positive");
+
+        pp_warpx.query("do_simd_particle_push", do_simd_particle_push);
+        pp_warpx.query("do_fused_push_and_deposition", do_fused_push_and_deposition);
+
         amrex::Real quantum_xi_tmp;
         int quantum_xi_is_specified = queryWithParser(pp_warpx, "quantum_xi", quantum_xi_tmp);
         if (quantum_xi_is_specified) {
@@ -962,6 +964,10 @@ WarpX::ReadParameters ()
         // note: current_deposition must be set after maxwell_solver is already determined,
         //       because its default depends on the solver selection
         current_deposition_algo = GetAlgorithmInteger(pp_algo, "current_deposition");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
+            !do_blocked_current_deposition ||
+            current_deposition_algo != CurrentDepositionAlgo::Vay,
+            "warpx.do_blocked_current_deposition is not implemented for the Vay deposition");
         charge_deposition_algo = GetAlgorithmInteger(pp_algo, "charge_deposition");
         particle_pusher_algo = GetAlgorithmInteger(pp_algo, "particle_pusher");
 
@@ -1003,13 +1009,13 @@ WarpX::ReadParameters ()
             if (pp_algo.query("particle_shape", particle_shape) == false)
             {
                 amrex::Abort("\nalgo.particle_shape must be set in the input file:"
-                             "\nplease set algo.particle_shape to 1, 2, or 3");
+                             "\nplease set algo.particle_shape to 1, 2, 3, 4 or 5");
             }
             else
             {
-                if (particle_shape < 1 || particle_shape > 3)
+                if (particle_shape < 1 || particle_shape > 5)
                 {
-                    amrex::Abort("\nalgo.particle_shape can be only 1, 2, or 3");
+                    amrex::Abort("\nalgo.particle_shape can be only 1, 2, 3, 4 or 5");
                 }
                 else
                 {
@@ -1256,16 +1262,6 @@ WarpX::ReadParameters ()
           }
        }
 
-       if (do_back_transformed_diagnostics) {
-          AMREX_ALWAYS_ASSERT_WITH_MESSAGE(gamma_boost > 1.0,
-                 "gamma_boost must be > 1 to use the boost frame diagnostic");
-          pp_slice.query("num_slice_snapshots_lab", num_slice_snapshots_lab);
-          if (num_slice_snapshots_lab > 0) {
-             getWithParser(pp_slice, "dt_slice_snapshots_lab", dt_slice_snapshots_lab );
-             getWithParser(pp_slice, "particle_slice_width_lab",particle_slice_width_lab);
-          }
-       }
-
     }
 }
 
@@ -1331,11 +1327,28 @@ WarpX::BackwardCompatibility ()
         amrex::Abort("warpx.sort_int is no longer a valid option. "
                      "Please use the renamed option warpx.sort_intervals instead.");
     }
+    if (pp_warpx.query("do_back_transformed_diagnostics", backward_int) ||
+        pp_warpx.query("num_snapshots_lab", backward_int) ||
+        pp_warpx.query("lab_data_directory", backward_str)){
+        amrex::Abort("warpx.do_back_transformed_diagnostics (and the associated parameters "
+                     "warpx.num_snapshots_lab, warpx.dt_snapshots_lab, warpx.dz_snapshots_lab, "
+                     "warpx.lab_data_directory) is not supported anymore. "
+                     "Please use the new syntax for diagnostics, with "
+                     "<diag_name>.diag_type = BackTransformed, see documentation.");
+    }
     if (pp_warpx.query("use_kspace_filter", backward_int)){
         amrex::Abort("warpx.use_kspace_filter is not supported anymore. "
                      "Please use the flag use_filter, see documentation.");
     }
 
+    ParmParse pp_slice("slice");
+    if (pp_slice.query("num_slice_snapshots_lab", backward_int)){
+        amrex::Abort("slice.num_slice_snapshots_lab (and the associated parameters "
+                     "slice.dt_slice_snapshots_lab, slice.particle_slice_width_lab) is not supported anymore. "
+                     "Please use a diagnostics with <diag_name>.diag_type = BackTransformed "
+                     "and a reduced domain <diag_name>.diag_lo, <diag_name>.diag_hi, see documentation.");
+    }
+
     ParmParse pp_interpolation("interpolation");
     if (pp_interpolation.query("nox", backward_int) ||
         pp_interpolation.query("noy", backward_int) ||
@@ -0,0 +1,59 @@
+# Copyright 2026 The WarpX Community
+#
+# This file is part of WarpX.
+#
+# License: BSD-3-Clause-LBNL
+
+# Micro-benchmark of the field gather and particle push on CPU.
+# Runs a WarpX executable on a uniform plasma, with and without
+# warpx.do_simd_particle_push, and reports the number of particles
+# pushed per second and per core, as measured by the TinyProfiler.
+#
+# Usage:
+#   python particle_push_benchmark.py --exe <path/to/warpx.3d.ex> \
+#       [--n_cell 64 64 64] [--n_step 20] [--n_mpi 1] [--n_omp 1]
+
+import argparse
+import os
+import re
+import subprocess
+
+parser = argparse.ArgumentParser(description='Benchmark the CPU particle push of WarpX')
+parser.add_argument('--exe', required=True, help='WarpX executable')
+parser.add_argument('--input_file', default='automated_test_1_uniform_rest_32ppc',
+                    help='Input file, relative to this directory')
+parser.add_argument('--n_cell', nargs=3, type=int, default=[64, 64, 64])
+parser.add_argument('--n_step', type=int, default=20)
+parser.add_argument('--n_mpi', type=int, default=1)
+parser.add_argument('--n_omp', type=int, default=1)
+parser.add_argument('--mpi_launcher', default='mpirun -np')
+args = parser.parse_args()
+
+timer_name = 'PhysicalParticleContainer::Evolve::GatherAndPush'
+# Electrons and ions, 2x2x4 particles per cell each
+n_part_per_cell = 2 * 16
+cwd = os.path.dirname(os.path.abspath(__file__))
+
+def run(do_simd):
+    command = args.mpi_launcher.split() + [str(args.n_mpi), args.exe,
+        os.path.join(cwd, args.input_file),
+        'max_step=%d' % args.n_step,
+        'amr.n_cell=%d %d %d' % tuple(args.n_cell),
+        'warpx.do_simd_particle_push=%d' % do_simd,
+        'tiny_profiler.device_synchronize_around_region=1']
+    env = dict(os.environ, OMP_NUM_THREADS=str(args.n_omp))
+    output = subprocess.run(command, env=env, check=True,
+                            stdout=subprocess.PIPE, universal_newlines=True).stdout
+    # Exclusive time, maximum over the MPI ranks:
+    # name  NCalls  Excl. Min  Excl. Avg  Excl. Max  Max %
+    line = re.search(re.escape(timer_name) + r'\s+(\d+)\s+(\S+)\s+(\S+)\s+(\S+)', output)
+    if line is None:
+        raise RuntimeError('Timer ' + timer_name + ' not found in the output')
+    return float(line.group(4))
+
+n_particles = n_part_per_cell * args.n_cell[0] * args.n_cell[1] * args.n_cell[2]
+n_cores = args.n_mpi * args.n_omp
+for do_simd in [0, 1]:
+    time = run(do_simd)
+    rate = n_particles * args.n_step / (time * n_cores)
+    print('do_simd_particle_push = %d: %.3e s, %.3e particles/s/core' % (do_simd, time, rate))
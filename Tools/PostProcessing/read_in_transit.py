@@ -0,0 +1,182 @@
+# Copyright 2026 The WarpX Community
+#
+# This file is part of WarpX.
+#
+# License: BSD-3-Clause-LBNL
+
+'''
+Reader of the shared-memory ring buffers written by diagnostics
+with ``<diag_name>.format = in_transit``.
+
+Each MPI rank publishes its data in its own file
+``<in_transit.dir>/warpx_<diag_name>_<rank>``, which this module maps in memory.
+The data is read in place: the arrays returned by ``InTransitReader.read``
+are copies, so that the buffer can be overwritten by the simulation afterwards.
+
+Usage, e.g. to monitor rank 0 of diagnostics diag1 while the simulation runs:
+
+    python read_in_transit.py /dev/shm/warpx_diag1_0
+'''
+
+import mmap
+import os
+import sys
+import time
+
+import numpy as np
+
+_MAGIC = b'WXINTRS1'
+_VERSION = 1
+_BUFFER_HEADER_SIZE = 6 * 8
+_SLOT_HEADER_SIZE = 3 * 8
+
+
+class InTransitReader:
+    '''
+    Reader of the ring buffer of one MPI rank of an in_transit diagnostics.
+    '''
+
+    def __init__(self, path, timeout=60.):
+        self.path = path
+        self.timeout = timeout
+        self._map = None
+        self._open()
+
+    def _open(self):
+        '''Map the buffer, waiting for the simulation to create it.'''
+        start = time.time()
+        while True:
+            try:
+                with open(self.path, 'rb') as f:
+                    buf = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+                if len(buf) >= _BUFFER_HEADER_SIZE and buf[0:8] == _MAGIC:
+                    break
+                buf.close()
+            except (FileNotFoundError, ValueError):
+                pass
+            if time.time() - start > self.timeout:
+                raise TimeoutError('No in_transit buffer found at ' + self.path)
+            time.sleep(0.01)
+        header = np.frombuffer(buf, dtype=np.uint64, count=6)
+        if header[1] != _VERSION:
+            raise RuntimeError('Unsupported in_transit buffer version {}'.format(header[1]))
+        self._map = buf
+        self.nslots = int(header[2])
+        self.slot_size = int(header[3])
+
+    def _word(self, offset):
+        return int(np.frombuffer(self._map, dtype=np.uint64, count=1, offset=offset)[0])
+
+    def close(self):
+        if self._map is not None:
+            self._map.close()
+            self._map = None
+
+    def num_messages(self):
+        '''Number of messages published since the start of the simulation.'''
+        if self._word(5 * 8) != 0:
+            # The simulation re-allocated a larger buffer: map the new one
+            self.close()
+            self._open()
+        return self._word(4 * 8)
+
+    def read(self, message=None):
+        '''
+        Read one message, by default the latest one.
+
+        Returns a dictionary with the iteration, time, fields and species of the message,
+        or None if the message was overwritten (or is being written) by the simulation.
+        Fields are given per level as a list of (lo, hi, data), where data has shape
+        (nx, [ny,] [nz,] ncomp). Species are given as dictionaries of 1D arrays.
+        '''
+        head = self.num_messages()
+        if head == 0:
+            return None
+        if message is None:
+            message = head - 1
+        if message >= head or head - message > self.nslots:
+            return None
+
+        slot = _BUFFER_HEADER_SIZE + (message % self.nslots) * self.slot_size
+        seq = 2 * message + 2
+        if self._word(slot) != seq:
+            return None
+        size = self._word(slot + 8)
+        header_size = self._word(slot + 16)
+        raw = bytes(self._map[slot + _SLOT_HEADER_SIZE:slot + _SLOT_HEADER_SIZE + size])
+        # The copy is only valid if the slot was not overwritten in the meantime
+        if self._word(slot) != seq:
+            return None
+
+        return _parse(raw[:header_size].decode(), memoryview(raw)[header_size:])
+
+
+def _parse(header, data):
+    lines = header.split('\n')
+    if lines[0] != 'WarpX-InTransit-V1':
+        raise RuntimeError('Invalid in_transit message')
+    result = {'levels': [], 'fields': [], 'fabs': [], 'species': {}}
+    real = np.float64
+    particle_real = np.float64
+    for line in lines[1:]:
+        words = line.split()
+        if not words:
+            continue
+        key = words[0]
+        if key == 'end':
+            break
+        elif key == 'iteration':
+            result['iteration'] = int(words[1])
+        elif key == 'time':
+            result['time'] = float(words[1])
+        elif key == 'rank':
+            result['rank'] = int(words[1])
+        elif key == 'real_size':
+            real = np.float64 if int(words[1]) == 8 else np.float32
+            particle_real = np.float64 if int(words[2]) == 8 else np.float32
+        elif key == 'level':
+            vals = words[2:]
+            dim = len(vals) // 4
+            result['levels'].append({
+                'domain_lo': [int(v) for v in vals[:dim]],
+                'domain_hi': [int(v) for v in vals[dim:2*dim]],
+                'prob_lo': [float(v) for v in vals[2*dim:3*dim]],
+                'prob_hi': [float(v) for v in vals[3*dim:]]})
+        elif key == 'fields':
+            result['fields'] = words[2:]
+        elif key == 'fab':
+            lev = int(words[1])
+            vals = [int(v) for v in words[2:]]
+            dim = (len(vals) - 1) // 2
+            lo, hi, offset = vals[:dim], vals[dim:2*dim], vals[-1]
+            shape = [h - l + 1 for l, h in zip(lo, hi)] + [len(result['fields'])]
+            arr = np.frombuffer(data, dtype=real, count=int(np.prod(shape)), offset=offset)
+            result['fabs'].append((lev, lo, hi, arr.reshape(shape, order='F')))
+        elif key == 'species':
+            name, npart = words[1], int(words[2])
+            species = {}
+            for item in words[3:]:
+                comp, offset = item.rsplit(':', 1)
+                dtype = np.uint64 if comp == 'id' else particle_real
+                species[comp] = np.frombuffer(data, dtype=dtype, count=npart, offset=int(offset))
+            result['species'][name] = species
+    return result
+
+
+if __name__ == '__main__':
+    # Minimal consumer: print a summary of each new message
+    reader = InTransitReader(sys.argv[1])
+    last = 0
+    while os.path.exists(reader.path):
+        head = reader.num_messages()
+        if head > last:
+            msg = reader.read()
+            last = head
+            if msg is None:
+                continue
+            print('iteration {} time {:.6e}: {} boxes of {}'.format(
+                msg['iteration'], msg['time'], len(msg['fabs']), ' '.join(msg['fields'])))
+            for name, species in msg['species'].items():
+                npart = len(next(iter(species.values()))) if species else 0
+                print('    {}: {} particles'.format(name, npart))
+        time.sleep(0.01)
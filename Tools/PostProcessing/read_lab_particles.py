@@ -9,7 +9,7 @@ from glob import glob
 import os
 
 it = 1
-fn = "./lab_frame_data/" + 'snapshot' + str(it).zfill(5) + "/particle1/"
+fn = "./diags/btd" + str(it).zfill(5) + "/particle1/"
 
 print(fn)
 
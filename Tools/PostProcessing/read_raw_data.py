@@ -7,6 +7,7 @@
 
 from glob import glob
 import os
+import re
 import numpy as np
 from collections import namedtuple
 
@@ -309,6 +310,100 @@ def _read_buffer(snapshot, header_fn, _component_names):
                 all_data[_component_names[i]] = data
     return all_data
 
+def read_roi_data(roi_dir):
+    '''
+
+    This function reads the fields written by a full diagnostics with the
+    <diag_name>.roi_names option, i.e. the fields in a set of regions of
+    interest, on their native staggering.
+
+    Arguments:
+
+        roi_dir : An output directory of the diagnostics, containing a Header
+                  file and Data_<rank> files.
+
+    Returns:
+
+        A dictionary with the iteration, time, and for each level the lower
+        corner of the domain and the cell size, and a list of dictionaries
+        (one per level) where data[lev][roi_name][field] is a tuple
+        (lo, array): lo is the index of the first point of the array.
+        The arrays are indexed (i, j[, k]), with an additional last axis
+        for the components of multi-mode (RZ) fields.
+
+    Example:
+
+        >>> info, data = read_roi_data("diags/roi00040")
+        >>> lo, Ex = data[0]['port1']['Ex']
+
+    '''
+    with open(roi_dir + "/Header", "r") as f:
+        version = f.readline().strip()
+        assert version == "WarpX-ROI-V1", "Unknown region-of-interest format " + version
+        iteration = int(f.readline())
+        time = float(f.readline())
+        nlev = int(f.readline())
+        prob_lo = []
+        dx = []
+        for lev in range(nlev):
+            values = [float(v) for v in f.readline().split()]
+            prob_lo.append(np.array(values[:len(values)//2]))
+            dx.append(np.array(values[len(values)//2:]))
+        nroi = int(f.readline())
+        roi_names = []
+        roi_bounds = {}
+        for iroi in range(nroi):
+            line = f.readline().split()
+            bounds = np.array([float(v) for v in line[1:]])
+            roi_names.append(line[0])
+            roi_bounds[line[0]] = (bounds[:len(bounds)//2], bounds[len(bounds)//2:])
+        nvar = int(f.readline())
+        varnames = [f.readline().strip() for ivar in range(nvar)]
+        nentries = int(f.readline())
+        entries = [f.readline().split() for ientry in range(nentries)]
+
+    # Read all FABs, then combine the FABs of a field in a region in one array
+    fabs = {}
+    for lev, ifield, iroi, fn, offset in entries:
+        key = (int(lev), roi_names[int(iroi)], varnames[int(ifield)])
+        fabs.setdefault(key, []).append(_read_roi_fab(roi_dir + "/" + fn, int(offset)))
+
+    data = [{name: {} for name in roi_names} for lev in range(nlev)]
+    for (lev, roi, field), field_fabs in fabs.items():
+        lo = np.min([fab_lo for fab_lo, arr in field_fabs], axis=0)
+        hi = np.max([fab_lo + np.array(arr.shape[:-1]) - 1 for fab_lo, arr in field_fabs], axis=0)
+        ncomp = field_fabs[0][1].shape[-1]
+        combined = np.zeros(tuple(hi - lo + 1) + (ncomp,), dtype=field_fabs[0][1].dtype)
+        for fab_lo, arr in field_fabs:
+            start = fab_lo - lo
+            combined[tuple(slice(s, s+n) for s, n in zip(start, arr.shape[:-1]))] = arr
+        if ncomp == 1:
+            combined = combined[..., 0]
+        data[lev][roi][field] = (lo, combined)
+
+    info = {'iteration' : iteration,
+            'time' : time,
+            'prob_lo' : prob_lo,
+            'dx' : dx,
+            'roi' : roi_bounds}
+    return info, data
+
+
+def _read_roi_fab(filename, offset):
+    # One FAB, as written by amrex::FArrayBox::writeOn: a text line
+    # "FAB ((nbytes, (...)),(...))((lo) (hi) (type)) ncomp" followed by the data
+    with open(filename, "rb") as f:
+        f.seek(offset)
+        line = f.readline().decode()
+        nbytes = int(re.match(r'FAB \(\((\d+),', line).group(1))
+        box = re.search(r'\(\(([-\d,]+)\) \(([-\d,]+)\) \(([\d,]+)\)\)\s*(\d+)\s*$', line)
+        lo = np.array([int(v) for v in box.group(1).split(',')], dtype=np.int64)
+        hi = np.array([int(v) for v in box.group(2).split(',')], dtype=np.int64)
+        ncomp = int(box.group(4))
+        shape = tuple(hi - lo + 1) + (ncomp,)
+        arr = np.fromfile(f, 'float%d' % (8*nbytes), np.prod(shape))
+    return lo, arr.reshape(shape, order='F')
+
 def read_reduced_diags(filename, delimiter=' '):
     '''
     Read data written by WarpX Reduced Diagnostics, and return them into Python objects
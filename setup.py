@@ -90,6 +90,7 @@ class CMakeBuild(build_ext):
             '-DWarpX_EB:BOOL=' + WarpX_EB,
             '-DWarpX_OPENPMD:BOOL=' + WarpX_OPENPMD,
             '-DWarpX_PRECISION=' + WarpX_PRECISION,
+            '-DWarpX_PARTICLE_PRECISION=' + WarpX_PARTICLE_PRECISION,
             '-DWarpX_PSATD:BOOL=' + WarpX_PSATD,
             '-DWarpX_QED:BOOL=' + WarpX_QED,
             '-DWarpX_QED_TABLE_GEN:BOOL=' + WarpX_QED_TABLE_GEN,
@@ -181,6 +182,7 @@ WarpX_MPI = os.environ.get('WarpX_MPI', 'OFF')
 WarpX_EB = os.environ.get('WarpX_EB', 'OFF')
 WarpX_OPENPMD = os.environ.get('WarpX_OPENPMD', 'OFF')
 WarpX_PRECISION = os.environ.get('WarpX_PRECISION', 'DOUBLE')
+WarpX_PARTICLE_PRECISION = os.environ.get('WarpX_PARTICLE_PRECISION', WarpX_PRECISION)
 WarpX_PSATD = os.environ.get('WarpX_PSATD', 'OFF')
 WarpX_QED = os.environ.get('WarpX_QED', 'ON')
 WarpX_QED_TABLE_GEN = os.environ.get('WarpX_QED_TABLE_GEN', 'OFF')